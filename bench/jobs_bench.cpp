@@ -0,0 +1,148 @@
+// Measures how the job system scales from 1 to N threads on world generation, frustum culling and
+// OBJ parsing, and prints the jobs every worker ran, stole and how busy it was
+//
+// Usage : jobs_bench [number of platforms] (default 4000000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "common/jobsystem.hpp"
+#include "common/objparser.hpp"
+#include "jump/models/frustum.h"
+#include "jump/models/platform_chain.h"
+#include "jump/models/world.h"
+
+#ifndef JUMP_SOURCE_DIR
+#define JUMP_SOURCE_DIR "."
+#endif
+
+// Keeps results alive so the measured work isn't optimized away
+static volatile size_t sink;
+
+struct Workload {
+	const char * name;
+	std::function<void(JobSystem &)> run;
+};
+
+static std::string readFile(const std::string & path){
+	std::string data;
+	FILE * file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+		return data;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		data.append(buffer, read);
+	fclose(file);
+	return data;
+}
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 4000000;
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+
+	World world;
+	world.initialize(42, count);
+
+	// Cameras spread over the world looking down the chain, so every cull sees a different part
+	std::vector<glm::mat4> viewProjections;
+	glm::mat4 projection = glm::perspective(glm::radians(70.f), 16.f / 9.f, .1f, 100.f);
+	for (size_t i = 0; i < 64; i++){
+		glm::vec3 target = world.platforms[(i * 7919) % world.platforms.size()].pos;
+		viewProjections.push_back(projection * glm::lookAt(target + glm::vec3(0, 2, 4), target, glm::vec3(0, 1, 0)));
+	}
+
+	std::string cube = readFile(JUMP_SOURCE_DIR "/jump/cube.obj");
+	if (cube.empty())
+		printf("cube.obj not found, OBJ parsing is skipped\n");
+
+	std::vector<Workload> workloads;
+	workloads.push_back(Workload{"generate", [count](JobSystem & jobs){
+		std::vector<Platform> platforms;
+		PlatformChain(42).generate(count, platforms, &jobs);
+		sink = platforms.size();
+	}});
+	workloads.push_back(Workload{"cull x64", [&world, &viewProjections](JobSystem & jobs){
+		std::vector<PlatformRange> ranges;
+		size_t visible = 0;
+		for (const glm::mat4 & viewProjection : viewProjections){
+			Frustum frustum;
+			frustum.extract(viewProjection);
+			visible += frustum.cullPlatforms(world.platforms, world.blocks, World::blockSize, 16, ranges, &jobs);
+		}
+		sink = visible;
+	}});
+	if (!cube.empty()){
+		workloads.push_back(Workload{"parse obj x20000", [&cube](JobSystem & jobs){
+			std::atomic<size_t> vertices{0};
+			jobs.parallelFor(20000, 16, [&](size_t begin, size_t end){
+				IndexedMesh mesh;
+				for (size_t i = begin; i < end; i++){
+					parseOBJ(cube.data(), cube.size(), mesh);
+					vertices += mesh.vertices.size();
+				}
+			});
+			sink = vertices;
+		}});
+	}
+	// Many tiny jobs, shows what a job costs
+	workloads.push_back(Workload{"empty jobs x100000", [](JobSystem & jobs){
+		std::atomic<size_t> done{0};
+		JobGroup group;
+		for (size_t i = 0; i < 100000; i++)
+			jobs.run(group, [&done]{ done++; });
+		jobs.wait(group);
+		sink = done;
+	}});
+
+	// Powers of two up to the number of cores, and the number of cores itself
+	std::vector<unsigned> threadCounts;
+	for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	printf("%zu platforms, %u cores\n", count, maxThreads);
+	for (const Workload & workload : workloads){
+		printf("%s\n", workload.name);
+		double single = 0;
+		for (unsigned threads : threadCounts){
+			JobSystem jobs(threads);
+
+			// One run to warm up, then the best of three
+			workload.run(jobs);
+			double best = 1e30, last = 0;
+			for (int repetition = 0; repetition < 3; repetition++){
+				jobs.resetStats();
+				auto start = std::chrono::steady_clock::now();
+				workload.run(jobs);
+				last = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				best = std::min(best, last);
+			}
+			if (threads == 1)
+				single = best;
+
+			printf("  %2u threads : %9.3f ms  speedup %5.2f\n", threads, best * 1e3, single / best);
+
+			// Stats of the last repetition, the last entry is the thread that started the work
+			std::vector<WorkerStats> stats = jobs.getStats();
+			for (size_t worker = 0; worker < stats.size(); worker++){
+				printf("      %s %2zu : %8llu jobs %8llu stolen %5.1f%% busy\n",
+					worker + 1 == stats.size() ? "caller" : "worker", worker,
+					(unsigned long long) stats[worker].executed, (unsigned long long) stats[worker].stolen,
+					last > 0 ? 100 * stats[worker].busySeconds / last : 0.);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,298 @@
+// Microbenchmarks of the game code that runs at startup and every frame. Every benchmark reports the best
+// nanoseconds per operation of a few repetitions, and is compared against a baseline file that has one
+// "name nanoseconds" pair per line. A benchmark slower than the baseline by more than the tolerance fails the run.
+//
+// Usage : jump_bench [--baseline file] [--update] [--output file] [--tolerance fraction] [--assets directory]
+//   --update writes the results as the new baseline instead of comparing
+//   --output writes the results in the baseline format as well
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "common/meshcache.hpp"
+#include "common/objloader.hpp"
+#include "common/packedmesh.hpp"
+#include "common/shader.hpp"
+#include "jump/models/bot.h"
+#include "jump/models/camera.h"
+#include "jump/models/frustum.h"
+#include "jump/models/light_clusters.h"
+#include "jump/models/player.h"
+#include "jump/models/world.h"
+
+#ifndef JUMP_SOURCE_DIR
+#define JUMP_SOURCE_DIR "."
+#endif
+
+struct BenchResult {
+	std::string name;
+	double nanoseconds;
+};
+
+// Keeps results alive so the measured work isn't optimized away
+static volatile float sink;
+
+// Calls run(iterations) with growing iteration counts until one batch takes long enough, then
+// keeps the fastest of a few batches. run returns the number of operations it did.
+template<typename Run>
+static BenchResult measure(const char * name, Run run){
+	const double minBatch = .1;
+	const int repetitions = 7;
+
+	size_t iterations = 1;
+	double best = 1e30;
+	for (int repetition = 0; repetition < repetitions;){
+		auto start = std::chrono::steady_clock::now();
+		size_t operations = run(iterations);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (seconds < minBatch && repetition == 0){
+			iterations *= seconds > 0 ? std::max<size_t>(2, (size_t) (minBatch / seconds)) : 10;
+			continue;
+		}
+		best = std::min(best, seconds * 1e9 / operations);
+		repetition++;
+	}
+
+	printf("%-28s %14.1f ns\n", name, best);
+	return BenchResult{name, best};
+}
+
+static std::map<std::string, double> readBaseline(const char * path){
+	std::map<std::string, double> baseline;
+	FILE * file = fopen(path, "r");
+	if (file == NULL)
+		return baseline;
+
+	char line[256], name[128];
+	double nanoseconds;
+	while (fgets(line, sizeof(line), file)){
+		if (line[0] != '#' && sscanf(line, "%127s %lf", name, &nanoseconds) == 2)
+			baseline[name] = nanoseconds;
+	}
+	fclose(file);
+	return baseline;
+}
+
+static bool writeBaseline(const char * path, const std::vector<BenchResult> & results){
+	FILE * file = fopen(path, "w");
+	if (file == NULL){
+		printf("Impossible to open %s for writing\n", path);
+		return false;
+	}
+	fprintf(file, "# jump_bench baseline, nanoseconds per operation. Regenerate with jump_bench --update.\n");
+	for (const BenchResult & result : results)
+		fprintf(file, "%s %.1f\n", result.name.c_str(), result.nanoseconds);
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char ** argv){
+	std::string baselinePath = JUMP_SOURCE_DIR "/bench/jump_bench.baseline";
+	std::string assets = JUMP_SOURCE_DIR "/jump";
+	double tolerance = .5;
+	bool update = false;
+	std::string outputPath;
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "--update") == 0) update = true;
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) outputPath = argv[++i];
+		else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+		else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) assets = argv[++i];
+		else {
+			fprintf(stderr, "Usage : %s [--baseline file] [--update] [--output file] [--tolerance fraction] "
+				"[--assets directory]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::vector<BenchResult> results;
+
+	// World generation per platform, at the default size and larger
+	const size_t counts[] = {201, 10000, 1000000};
+	for (size_t count : counts){
+		std::string name = "world_initialize_" + std::to_string(count);
+		results.push_back(measure(name.c_str(), [count](size_t iterations){
+			for (size_t i = 0; i < iterations; i++){
+				World world;
+				world.initialize(i, count);
+				sink = world.platforms.back().pos.y;
+			}
+			return iterations * count;
+		}));
+	}
+
+	// One simulation step including the collision query, played by the bot
+	World world;
+	world.initialize(1, 201);
+	results.push_back(measure("player_update", [&world](size_t iterations){
+		Player player;
+		Bot bot;
+		for (size_t i = 0; i < iterations; i++){
+			PlayerInput input = bot.update(player, world);
+			player.updatePlayer(input, bot.direction, bot.right, world, 1.f / 240.f);
+			world.advance(1.f / 240.f);
+		}
+		sink = player.pos.y;
+		return iterations;
+	}));
+
+	std::string cubePath = assets + "/cube.obj";
+	results.push_back(measure("load_obj_cube", [&cubePath](size_t iterations){
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		for (size_t i = 0; i < iterations; i++){
+			vertices.clear();
+			uvs.clear();
+			normals.clear();
+			loadOBJ(cubePath.c_str(), vertices, uvs, normals);
+		}
+		sink = (float) vertices.size();
+		return iterations;
+	}));
+
+	std::string vertexPath = assets + "/WorldShader.vertexshader";
+	std::string fragmentPath = assets + "/WorldShader.fragmentshader";
+	results.push_back(measure("read_shader_files", [&vertexPath, &fragmentPath](size_t iterations){
+		size_t length = 0;
+		for (size_t i = 0; i < iterations; i++){
+			std::string vertexCode, fragmentCode;
+			ReadShaderFile(vertexPath.c_str(), vertexCode);
+			ReadShaderFile(fragmentPath.c_str(), fragmentCode);
+			length += vertexCode.size() + fragmentCode.size();
+		}
+		sink = (float) length;
+		return iterations;
+	}));
+
+	// Matrices are built from a moving player, so nothing can be hoisted out of the loop
+	results.push_back(measure("player_model_matrix", [](size_t iterations){
+		Player player;
+		float sum = 0;
+		for (size_t i = 0; i < iterations; i++){
+			player.pos.x = (float) (i & 1023);
+			sum += player.getModelMatrix(.5f)[3][0];
+		}
+		sink = sum;
+		return iterations;
+	}));
+
+	results.push_back(measure("camera_view_matrix", [](size_t iterations){
+		Camera cam;
+		cam.updateLookingPosition(glm::vec3(0, 1, 0), 1.f / 240.f);
+		float sum = 0;
+		for (size_t i = 0; i < iterations; i++){
+			cam.direction = glm::vec3((float) (i & 1023) * 1e-3f, 0, -1);
+			sum += cam.getViewMatrix(.5f)[3][0];
+		}
+		sink = sum;
+		return iterations;
+	}));
+
+	// Culling a large world seen from platforms all over it, per frame
+	World largeWorld;
+	largeWorld.initialize(1, 1000000);
+	results.push_back(measure("frustum_cull_1000000", [&largeWorld](size_t iterations){
+		Camera cam;
+		cam.updateProjectionMatrix(1600, 900);
+		std::vector<PlatformRange> ranges;
+		size_t visible = 0;
+		for (size_t i = 0; i < iterations; i++){
+			glm::vec3 center = largeWorld.platforms[(i * 7919) % largeWorld.platforms.size()].pos;
+			cam.updateLookingPosition(center, 1);
+			cam.direction = glm::normalize(glm::vec3(0, -.5f, -1));
+			Frustum frustum;
+			frustum.extract(cam.getProjectionMatrix() * cam.getViewMatrix());
+			visible += frustum.cullPlatforms(largeWorld.platforms, largeWorld.blocks, World::blockSize, 16, ranges);
+		}
+		sink = (float) visible;
+		return iterations;
+	}));
+
+	// Assigning a few hundred lights around the camera to the clusters of a frame
+	results.push_back(measure("light_clusters_256", [](size_t iterations){
+		Camera cam;
+		cam.updateProjectionMatrix(1600, 900);
+		cam.updateLookingPosition(glm::vec3(0, .5f, 0), 1);
+		cam.direction = glm::normalize(glm::vec3(0, -.3f, -1));
+		std::vector<PointLight> lights;
+		for (int i = 0; i < 256; i++){
+			glm::vec3 position(i % 16 - 7.5f, (i / 16) % 4 * .5f, -(float) (i / 4) * .3f);
+			lights.push_back(PointLight{position, 1.2f, glm::vec3(1), .1f});
+		}
+		LightClusters clusters;
+		size_t assigned = 0;
+		for (size_t i = 0; i < iterations; i++){
+			clusters.assign(lights, cam.getViewMatrix(), cam.getProjectionMatrix(), Camera::nearPlane, Camera::farPlane);
+			assigned += clusters.indices.size();
+		}
+		sink = (float) assigned;
+		return iterations;
+	}));
+
+	// Landing test against every platform of a large world, one at a time and with the SIMD kernel
+	for (int vectorized = 0; vectorized < 2; vectorized++){
+		const char * name = vectorized ? "cast_down_all_1000000" : "cast_down_all_scalar_1000000";
+		results.push_back(measure(name, [&largeWorld, vectorized](size_t iterations){
+			size_t hits = 0;
+			for (size_t i = 0; i < iterations; i++){
+				glm::vec3 origin = largeWorld.platforms[(i * 7919) % largeWorld.platforms.size()].pos + glm::vec3(0, .1f, 0);
+				PlatformHit hit;
+				hits += largeWorld.grid.castDownAll(origin, glm::vec2(.05f), .2f, hit, vectorized != 0);
+			}
+			sink = (float) hits;
+			return iterations;
+		}));
+	}
+
+	// GPU memory of the cube and player mesh, as separate float buffers and packed with indices
+	std::vector<glm::vec3> cubeVertices, cubeNormals;
+	std::vector<glm::vec2> cubeUvs;
+	loadOBJ(cubePath.c_str(), cubeVertices, cubeUvs, cubeNormals);
+	Mesh cube{cubeVertices, cubeUvs, cubeNormals};
+	PackedMesh packed;
+	PackedMeshRange cubeRange, playerRange;
+	appendPackedMesh(*getUnitCubeMesh(), packed, cubeRange);
+	appendPackedMesh(cube, packed, playerRange);
+	size_t floatBytes = (getUnitCubeMesh()->vertices.size() + cube.vertices.size()) * 2 * sizeof(glm::vec3);
+	printf("mesh memory : %zu bytes as float buffers, %zu bytes packed (%zu vertices, %zu indices), %.0f%% less\n",
+		floatBytes, packedMeshBytes(packed), packed.vertices.size(), packed.indices.size(),
+		100. - 100. * packedMeshBytes(packed) / floatBytes);
+
+	if (!outputPath.empty() && !writeBaseline(outputPath.c_str(), results))
+		return 1;
+	if (update)
+		return writeBaseline(baselinePath.c_str(), results) ? 0 : 1;
+
+	std::map<std::string, double> baseline = readBaseline(baselinePath.c_str());
+	if (baseline.empty()){
+		printf("No baseline in %s, run with --update to create one\n", baselinePath.c_str());
+		return 0;
+	}
+
+	int regressions = 0;
+	for (const BenchResult & result : results){
+		auto it = baseline.find(result.name);
+		if (it == baseline.end())
+			continue;
+
+		double ratio = result.nanoseconds / it->second;
+		if (ratio > 1 + tolerance){
+			printf("REGRESSION %s : %.1f ns, baseline %.1f ns (%+.0f%%)\n", result.name.c_str(), result.nanoseconds,
+				it->second, (ratio - 1) * 100);
+			regressions++;
+		}
+	}
+	printf("%d of %zu benchmarks slower than the baseline by more than %.0f%%\n", regressions, results.size(),
+		tolerance * 100);
+	return regressions > 0 ? 1 : 0;
+}
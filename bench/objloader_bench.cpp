@@ -0,0 +1,83 @@
+// Compares the throughput of loadOBJ and loadOBJIndexed on a generated grid mesh
+//
+// Usage : objloader_bench [quads per side] (default 1000, which is 2 million triangles)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "common/objloader.hpp"
+#include "common/objparser.hpp"
+
+// Write a height field of n x n quads as v/vt/vn triangles, the only format loadOBJ understands
+static long writeGrid(const char * path, int n){
+	FILE * file = fopen(path, "w");
+	if (file == NULL)
+		return -1;
+
+	for (int z = 0; z <= n; z++)
+		for (int x = 0; x <= n; x++)
+			fprintf(file, "v %f %f %f\n", x / (float) n, 0.05f * ((x * 7 + z * 13) % 17) / 17.f, z / (float) n);
+	for (int z = 0; z <= n; z++)
+		for (int x = 0; x <= n; x++)
+			fprintf(file, "vt %f %f\n", x / (float) n, z / (float) n);
+	fprintf(file, "vn 0.000000 1.000000 0.000000\n");
+
+	for (int z = 0; z < n; z++){
+		for (int x = 0; x < n; x++){
+			int a = z * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+			fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, c, c, b, b);
+			fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", b, b, c, c, d, d);
+		}
+	}
+
+	long size = ftell(file);
+	fclose(file);
+	return size;
+}
+
+template<typename F>
+static double seconds(F f){
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char ** argv){
+	int n = argc > 1 ? atoi(argv[1]) : 1000;
+	const char * path = "objloader_bench.obj";
+
+	long size = writeGrid(path, n);
+	if (size <= 0){
+		fprintf(stderr, "Can't write %s\n", path);
+		return 1;
+	}
+	double megabytes = size / (1024. * 1024.);
+	printf("%s : %.1f MB, %d triangles\n", path, megabytes, 2 * n * n);
+
+	std::vector<glm::vec3> vertices, normals;
+	std::vector<glm::vec2> uvs;
+	double fscanfTime = seconds([&]{ loadOBJ(path, vertices, uvs, normals); });
+
+	IndexedMesh mesh;
+	double parserTime = seconds([&]{ loadOBJIndexed(path, mesh); });
+
+	// Both loaders have to agree on the triangles
+	bool same = vertices.size() == mesh.indices.size();
+	for (size_t i = 0; same && i < vertices.size(); i++)
+		same = vertices[i] == mesh.vertices[mesh.indices[i]] && uvs[i] == mesh.uvs[mesh.indices[i]];
+
+	printf("loadOBJ        : %8.3f s %8.1f MB/s\n", fscanfTime, megabytes / fscanfTime);
+	printf("loadOBJIndexed : %8.3f s %8.1f MB/s (%.1fx), %zu unique vertices\n",
+		parserTime, megabytes / parserTime, fscanfTime / parserTime, mesh.vertices.size());
+
+	remove(path);
+	if (!same){
+		fprintf(stderr, "Loaders returned different meshes\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+// Measures how fast the platform chain is generated with job systems of 1 to N threads and checks that
+// every thread count gives a bit-identical world
+//
+// Usage : worldgen_bench [number of platforms] (default 10000000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "common/jobsystem.hpp"
+#include "jump/models/platform_chain.h"
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+	if (count == 0){
+		fprintf(stderr, "Usage : %s [number of platforms]\n", argv[0]);
+		return 1;
+	}
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+
+	PlatformChain chain(42);
+	std::vector<Platform> reference, platforms;
+	JobSystem single(1);
+	chain.generate(count, reference, &single);
+
+	printf("%zu platforms, top at %.1f\n", count, reference.back().pos.y);
+
+	// Powers of two up to the number of cores, and the number of cores itself
+	std::vector<unsigned> threadCounts;
+	for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	bool identical = true;
+	for (unsigned threads : threadCounts){
+		JobSystem jobs(threads);
+		auto start = std::chrono::steady_clock::now();
+		chain.generate(count, platforms, &jobs);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		bool same = memcmp(platforms.data(), reference.data(), count * sizeof(Platform)) == 0;
+		identical = identical && same;
+		printf("%2u threads : %8.3f s %12.0f platforms/s%s\n", threads, seconds, count / seconds, same ? "" : " DIFFERENT");
+	}
+
+	// The sequential generator of the endless mode has to agree as well
+	PlatformChain sequential(42);
+	size_t checked = count < 100000 ? count : 100000;
+	for (size_t i = 0; i < checked; i++){
+		Platform p = i == 0 ? sequential.first() : sequential.next();
+		if (memcmp(&reference[i], &p, sizeof(Platform)) != 0){
+			identical = false;
+			break;
+		}
+	}
+
+	if (!identical){
+		fprintf(stderr, "Generated worlds differ\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "filewatcher.hpp"
+
+static long long modificationTime(const std::string & path){
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+		return -1;
+	return (long long) status.st_mtime;
+}
+
+FileWatcher::FileWatcher() : notify(-1){
+#ifdef __linux__
+	notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (notify < 0)
+		printf("inotify is not available, falling back to modification times\n");
+#endif
+}
+
+FileWatcher::~FileWatcher(){
+#ifdef __linux__
+	if (notify >= 0)
+		close(notify);
+#endif
+}
+
+bool FileWatcher::watch(const std::string & path){
+	size_t slash = path.find_last_of("/\\");
+	WatchedFile file;
+	file.path = path;
+	file.directory = slash == std::string::npos ? "." : path.substr(0, slash);
+	file.name = slash == std::string::npos ? path : path.substr(slash + 1);
+	file.modified = modificationTime(path);
+
+#ifdef __linux__
+	// Editors often replace a file instead of writing it, so the directory is watched rather than the file
+	if (notify >= 0){
+		bool watched = false;
+		for (const auto & directory : directories)
+			watched = watched || directory.second == file.directory;
+		if (!watched){
+			int descriptor = inotify_add_watch(notify, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (descriptor < 0)
+				return false;
+			directories.push_back(std::make_pair(descriptor, file.directory));
+		}
+	}
+#endif
+
+	files.push_back(file);
+	return notify >= 0 || file.modified >= 0;
+}
+
+std::vector<std::string> FileWatcher::poll(){
+	std::vector<std::string> changed;
+
+#ifdef __linux__
+	if (notify >= 0){
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(notify, buffer, sizeof(buffer))) > 0){
+			for (char * pointer = buffer; pointer < buffer + length;){
+				const struct inotify_event * event = (const struct inotify_event *) pointer;
+				pointer += sizeof(struct inotify_event) + event->len;
+				if (event->len == 0)
+					continue;
+
+				for (const WatchedFile & file : files){
+					bool inDirectory = false;
+					for (const auto & directory : directories)
+						inDirectory = inDirectory || (directory.first == event->wd && directory.second == file.directory);
+					if (inDirectory && file.name == event->name
+							&& std::find(changed.begin(), changed.end(), file.path) == changed.end())
+						changed.push_back(file.path);
+				}
+			}
+		}
+		return changed;
+	}
+#endif
+
+	for (WatchedFile & file : files){
+		long long modified = modificationTime(file.path);
+		if (modified != file.modified && modified >= 0)
+			changed.push_back(file.path);
+		file.modified = modified;
+	}
+	return changed;
+}
@@ -0,0 +1,38 @@
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <string>
+#include <vector>
+
+// Reports files that were written since the last poll, to reload assets while the game runs. Uses inotify
+// on the directories of the files on Linux, and compares modification times elsewhere.
+class FileWatcher {
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher & operator=(const FileWatcher &) = delete;
+
+	// Start watching a file, returns false if it can't be watched
+	bool watch(const std::string & path);
+
+	// Never blocks. A file that is written several times is reported once.
+	std::vector<std::string> poll();
+
+private:
+	struct WatchedFile {
+		std::string path;
+		std::string directory;
+		std::string name;
+		long long modified;
+	};
+
+	std::vector<WatchedFile> files;
+
+	// inotify instance and the watch of every directory
+	int notify;
+	std::vector<std::pair<int, std::string> > directories;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <chrono>
+
+#include "jobsystem.hpp"
+
+// Index of the queue of the current thread within its job system, the last queue for other threads
+static thread_local const JobSystem * currentSystem = nullptr;
+static thread_local size_t currentQueue = 0;
+
+JobSystem::JobSystem(unsigned threads){
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned i = 0; i < threads; i++)
+		queues.emplace_back(new Worker());
+	for (unsigned i = 0; i + 1 < threads; i++)
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem(){
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread & worker : workers)
+		worker.join();
+}
+
+JobSystem & JobSystem::global(){
+	static JobSystem jobs;
+	return jobs;
+}
+
+void JobSystem::run(JobGroup & group, Job job){
+	group.pending.fetch_add(1, std::memory_order_relaxed);
+
+	// Workers keep their jobs to themselves until they are stolen, other threads spread them over the workers
+	size_t index = currentSystem == this ? currentQueue : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->mutex);
+		queues[index]->jobs.push_back(QueuedJob{std::move(job), &group});
+	}
+	queued.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders the increment before a worker checks it and goes to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::takeJob(size_t index, QueuedJob & job){
+	if (queued.load(std::memory_order_acquire) == 0)
+		return false;
+
+	// Newest own job first, it is most likely still in the cache
+	{
+		Worker & own = *queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()){
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Oldest job of another queue, usually the biggest piece of work left there
+	for (size_t offset = 1; offset < queues.size(); offset++){
+		Worker & victim = *queues[(index + offset) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()){
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			queues[index]->stolen.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(size_t index, QueuedJob & job){
+	auto start = std::chrono::steady_clock::now();
+	job.job();
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+	Worker & worker = *queues[index];
+	worker.executed.fetch_add(1, std::memory_order_relaxed);
+	worker.busyNanoseconds.fetch_add((uint64_t) elapsed.count(), std::memory_order_relaxed);
+	job.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(size_t index){
+	currentSystem = this;
+	currentQueue = index;
+
+	QueuedJob job;
+	while (true){
+		if (takeJob(index, job)){
+			execute(index, job);
+			job.job = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]{ return stopping || queued.load(std::memory_order_acquire) > 0; });
+		if (stopping)
+			return;
+	}
+}
+
+void JobSystem::wait(JobGroup & group){
+	// Other threads share the last queue, workers that wait keep using their own
+	size_t index = currentSystem == this ? currentQueue : queues.size() - 1;
+
+	QueuedJob job;
+	while (!group.isDone()){
+		if (takeJob(index, job)){
+			execute(index, job);
+			job.job = nullptr;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const RangeJob & body){
+	if (count == 0)
+		return;
+
+	// A few ranges per thread, so threads that finish early can steal the rest
+	size_t chunk = std::max<size_t>(std::max<size_t>(grain, 1), (count + 4 * getThreadCount() - 1) / (4 * getThreadCount()));
+	if (chunk >= count){
+		body(0, count);
+		return;
+	}
+
+	JobGroup group;
+	for (size_t begin = chunk; begin < count; begin += chunk){
+		size_t end = std::min(count, begin + chunk);
+		run(group, [&body, begin, end]{ body(begin, end); });
+	}
+	body(0, chunk);
+	wait(group);
+}
+
+std::vector<WorkerStats> JobSystem::getStats() const{
+	std::vector<WorkerStats> stats;
+	for (const std::unique_ptr<Worker> & worker : queues){
+		stats.push_back(WorkerStats{worker->executed.load(), worker->stolen.load(),
+			worker->busyNanoseconds.load() * 1e-9});
+	}
+	return stats;
+}
+
+void JobSystem::resetStats(){
+	for (std::unique_ptr<Worker> & worker : queues){
+		worker->executed = 0;
+		worker->stolen = 0;
+		worker->busyNanoseconds = 0;
+	}
+}
+
+size_t TaskGraph::add(JobSystem::Job task){
+	tasks.emplace_back();
+	tasks.back().job = std::move(task);
+	tasks.back().remaining.reset(new std::atomic<size_t>(0));
+	return tasks.size() - 1;
+}
+
+void TaskGraph::precede(size_t before, size_t after){
+	tasks[before].successors.push_back(after);
+	tasks[after].dependencies++;
+}
+
+void TaskGraph::start(JobSystem & jobs, JobGroup & group, size_t task){
+	jobs.run(group, [this, &jobs, &group, task]{
+		tasks[task].job();
+
+		// The last finished dependency starts a task
+		for (size_t successor : tasks[task].successors){
+			if (tasks[successor].remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+				start(jobs, group, successor);
+		}
+	});
+}
+
+void TaskGraph::run(JobSystem & jobs){
+	for (Task & task : tasks)
+		task.remaining->store(task.dependencies, std::memory_order_relaxed);
+
+	JobGroup group;
+	for (size_t task = 0; task < tasks.size(); task++){
+		if (tasks[task].dependencies == 0)
+			start(jobs, group, task);
+	}
+	jobs.wait(group);
+}
@@ -0,0 +1,120 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs that are waited for together. Must outlive the wait.
+class JobGroup {
+public:
+	bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<size_t> pending{0};
+};
+
+// Counters of one worker, the thread that isn't a worker (e.g. the main thread) is counted as the last one
+struct WorkerStats {
+	uint64_t executed;
+	uint64_t stolen;
+	double busySeconds;
+};
+
+// Work-stealing thread pool. Every worker pushes and pops jobs at the back of its own queue, idle workers
+// steal from the front of the others. Threads that wait for a group run jobs in the meantime, so jobs may
+// start and wait for further jobs.
+class JobSystem {
+public:
+	typedef std::function<void()> Job;
+	typedef std::function<void(size_t begin, size_t end)> RangeJob;
+
+	// threads counts the calling thread, 0 uses every core
+	explicit JobSystem(unsigned threads = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem &) = delete;
+	JobSystem & operator=(const JobSystem &) = delete;
+
+	// Workers plus the thread that waits
+	unsigned getThreadCount() const { return (unsigned) workers.size() + 1; }
+
+	void run(JobGroup & group, Job job);
+
+	// Run jobs until every job of the group is done
+	void wait(JobGroup & group);
+
+	// Call body on consecutive ranges of [0, count) of at least grain items, returns when all are done
+	void parallelFor(size_t count, size_t grain, const RangeJob & body);
+
+	// One entry per worker and one for the other threads
+	std::vector<WorkerStats> getStats() const;
+	void resetStats();
+
+	// Shared pool with a worker per core, created on first use
+	static JobSystem & global();
+
+private:
+	struct QueuedJob {
+		Job job;
+		JobGroup * group;
+	};
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<QueuedJob> jobs;
+		std::atomic<uint64_t> executed{0};
+		std::atomic<uint64_t> stolen{0};
+		std::atomic<uint64_t> busyNanoseconds{0};
+	};
+
+	void workerLoop(size_t index);
+	bool takeJob(size_t index, QueuedJob & job);
+	void execute(size_t index, QueuedJob & job);
+
+	// Queues of the workers and one for the other threads, which is also where they push their jobs
+	std::vector<std::unique_ptr<Worker> > queues;
+	std::vector<std::thread> workers;
+
+	std::atomic<size_t> queued{0};
+	std::atomic<size_t> nextQueue{0};
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
+
+// Jobs with dependencies, built once and run as often as needed. A task starts when every task it
+// depends on has finished, independent tasks run in parallel.
+class TaskGraph {
+public:
+	// Returns the handle for precede
+	size_t add(JobSystem::Job task);
+
+	// after only starts once before has finished
+	void precede(size_t before, size_t after);
+
+	// Run every task and return when all are done. The graph must not have cycles.
+	void run(JobSystem & jobs);
+
+private:
+	struct Task {
+		JobSystem::Job job;
+		std::vector<size_t> successors;
+		size_t dependencies = 0;
+		std::unique_ptr<std::atomic<size_t> > remaining;
+	};
+
+	void start(JobSystem & jobs, JobGroup & group, size_t task);
+
+	std::vector<Task> tasks;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "meshbinary.hpp"
+
+static uint64_t alignOffset(uint64_t offset){
+	return (offset + MESH_BINARY_ALIGNMENT - 1) / MESH_BINARY_ALIGNMENT * MESH_BINARY_ALIGNMENT;
+}
+
+// Pad the file with zeros up to offset and write a section there
+static bool writeSection(FILE * file, uint64_t offset, const void * data, size_t size){
+	static const char zeros[MESH_BINARY_ALIGNMENT] = {};
+	long position = ftell(file);
+	if (position < 0 || (uint64_t) position > offset)
+		return false;
+	size_t padding = (size_t) (offset - position);
+	if (fwrite(zeros, 1, padding, file) != padding)
+		return false;
+	return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+bool saveMeshBinary(
+	const char * path,
+	const std::vector<glm::vec3> & vertices,
+	const std::vector<glm::vec2> & uvs,
+	const std::vector<glm::vec3> & normals,
+	const std::vector<uint32_t> & indices
+){
+	if (uvs.size() != vertices.size() || normals.size() != vertices.size()){
+		printf("Can't write %s : attribute arrays have different lengths\n", path);
+		return false;
+	}
+	for (uint32_t index : indices){
+		if (index >= vertices.size()){
+			printf("Can't write %s : index %u is out of range\n", path, index);
+			return false;
+		}
+	}
+
+	MeshBinaryHeader header;
+	memcpy(header.magic, MESH_BINARY_MAGIC, 4);
+	header.version = MESH_BINARY_VERSION;
+	header.vertexCount = (uint32_t) vertices.size();
+	header.indexCount = (uint32_t) indices.size();
+	header.positionOffset = alignOffset(sizeof(MeshBinaryHeader));
+	header.normalOffset = alignOffset(header.positionOffset + vertices.size() * sizeof(glm::vec3));
+	header.uvOffset = alignOffset(header.normalOffset + normals.size() * sizeof(glm::vec3));
+	header.indexOffset = alignOffset(header.uvOffset + uvs.size() * sizeof(glm::vec2));
+
+	FILE * file = fopen(path, "wb");
+	if (file == NULL){
+		printf("Impossible to open %s for writing\n", path);
+		return false;
+	}
+
+	bool ok = writeSection(file, 0, &header, sizeof(header))
+		&& writeSection(file, header.positionOffset, vertices.data(), vertices.size() * sizeof(glm::vec3))
+		&& writeSection(file, header.normalOffset, normals.data(), normals.size() * sizeof(glm::vec3))
+		&& writeSection(file, header.uvOffset, uvs.data(), uvs.size() * sizeof(glm::vec2))
+		&& writeSection(file, header.indexOffset, indices.data(), indices.size() * sizeof(uint32_t));
+
+	if (fclose(file) != 0)
+		ok = false;
+	if (!ok)
+		printf("Failed to write %s\n", path);
+	return ok;
+}
+
+MappedMesh::MappedMesh() : data(NULL), size(0)
+#ifdef _WIN32
+	, file(NULL), mapping(NULL)
+#endif
+{}
+
+MappedMesh::~MappedMesh(){
+	close();
+}
+
+// True if a section of count elements starting at offset lies inside the mapping
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, size_t fileSize){
+	return offset % MESH_BINARY_ALIGNMENT == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+bool MappedMesh::open(const char * path){
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE){
+		file = NULL;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t) fileSize.QuadPart;
+	if (size >= sizeof(MeshBinaryHeader)){
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(MeshBinaryHeader)){
+		size = (size_t) st.st_size;
+		void * mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
+			data = mapped;
+	}
+	// The mapping keeps the file alive
+	::close(fd);
+#endif
+
+	if (data == NULL){
+		printf("Impossible to map %s\n", path);
+		close();
+		return false;
+	}
+
+	const MeshBinaryHeader * h = header();
+	if (memcmp(h->magic, MESH_BINARY_MAGIC, 4) != 0 || h->version != MESH_BINARY_VERSION){
+		printf("%s is not a mesh file of version %d\n", path, MESH_BINARY_VERSION);
+		close();
+		return false;
+	}
+	// The file may be stale or edited by hand, all sections must be inside it
+	if (h->indexCount % 3 != 0 ||
+		!sectionFits(h->positionOffset, h->vertexCount, sizeof(glm::vec3), size) ||
+		!sectionFits(h->normalOffset, h->vertexCount, sizeof(glm::vec3), size) ||
+		!sectionFits(h->uvOffset, h->vertexCount, sizeof(glm::vec2), size) ||
+		!sectionFits(h->indexOffset, h->indexCount, sizeof(uint32_t), size)){
+		printf("%s is truncated or corrupt\n", path);
+		close();
+		return false;
+	}
+
+	// Vertices are looked up by index without further checks
+	const uint32_t * fileIndices = indices();
+	for (uint32_t i = 0; i < h->indexCount; i++){
+		if (fileIndices[i] >= h->vertexCount){
+			printf("%s has an index out of range\n", path);
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MappedMesh::close(){
+#ifdef _WIN32
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != NULL)
+		CloseHandle(file);
+	mapping = NULL;
+	file = NULL;
+#else
+	if (data != NULL)
+		munmap(data, size);
+#endif
+	data = NULL;
+	size = 0;
+}
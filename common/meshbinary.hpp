@@ -0,0 +1,80 @@
+#ifndef MESHBINARY_HPP
+#define MESHBINARY_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Binary mesh file, written by the obj2mesh tool and mapped into memory at runtime.
+//
+// Layout (little endian) :
+// - MeshBinaryHeader
+// - vertexCount positions, 3 floats each
+// - vertexCount normals, 3 floats each
+// - vertexCount uvs, 2 floats each
+// - indexCount indices, uint32 each, 3 per triangle
+// Every section starts at a multiple of MESH_BINARY_ALIGNMENT, the offsets are stored in the header.
+
+#define MESH_BINARY_MAGIC "GJMB"
+#define MESH_BINARY_VERSION 1
+#define MESH_BINARY_ALIGNMENT 16
+
+struct MeshBinaryHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint64_t positionOffset;
+	uint64_t normalOffset;
+	uint64_t uvOffset;
+	uint64_t indexOffset;
+};
+
+// Write an indexed mesh. All attribute arrays must have the same length.
+bool saveMeshBinary(
+	const char * path,
+	const std::vector<glm::vec3> & vertices,
+	const std::vector<glm::vec2> & uvs,
+	const std::vector<glm::vec3> & normals,
+	const std::vector<uint32_t> & indices
+);
+
+// Read-only view of a binary mesh file mapped into memory. Nothing is copied, the pointers
+// point straight into the mapping and stay valid until the object is closed or destroyed.
+class MappedMesh {
+public:
+	MappedMesh();
+	~MappedMesh();
+
+	MappedMesh(const MappedMesh &) = delete;
+	MappedMesh & operator=(const MappedMesh &) = delete;
+
+	// Map a file and check its header and indices. Returns false if it can't be opened or is not a valid mesh.
+	bool open(const char * path);
+	void close();
+
+	uint32_t vertexCount() const { return header()->vertexCount; }
+	uint32_t indexCount() const { return header()->indexCount; }
+
+	const glm::vec3 * positions() const { return section<glm::vec3>(header()->positionOffset); }
+	const glm::vec3 * normals() const { return section<glm::vec3>(header()->normalOffset); }
+	const glm::vec2 * uvs() const { return section<glm::vec2>(header()->uvOffset); }
+	const uint32_t * indices() const { return section<uint32_t>(header()->indexOffset); }
+
+private:
+	const MeshBinaryHeader * header() const { return (const MeshBinaryHeader *) data; }
+
+	template<typename T>
+	const T * section(uint64_t offset) const { return (const T *) ((const char *) data + offset); }
+
+	void * data;
+	size_t size;
+#ifdef _WIN32
+	void * file;
+	void * mapping;
+#endif
+};
+
+#endif
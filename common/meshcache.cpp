@@ -0,0 +1,92 @@
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "meshcache.hpp"
+#include "meshbinary.hpp"
+#include "objparser.hpp"
+#include "primitives.hpp"
+
+static std::mutex cacheMutex;
+static std::map<std::string, std::shared_ptr<const Mesh> > cache;
+
+// Expand indexed attributes into the de-indexed layout of Mesh, the indices must be in range
+static void expandIndexed(const glm::vec3 * positions, const glm::vec2 * uvs, const glm::vec3 * normals,
+		const uint32_t * indices, size_t count, Mesh & mesh){
+	mesh.vertices.resize(count);
+	mesh.uvs     .resize(count);
+	mesh.normals .resize(count);
+	for (size_t i = 0; i < count; i++){
+		mesh.vertices[i] = positions[indices[i]];
+		mesh.uvs[i]      = uvs[indices[i]];
+		mesh.normals[i]  = normals[indices[i]];
+	}
+}
+
+static bool loadMeshBinary(const char * path, Mesh & mesh){
+	MappedMesh mapped;
+	if (!mapped.open(path))
+		return false;
+
+	expandIndexed(mapped.positions(), mapped.uvs(), mapped.normals(), mapped.indices(), mapped.indexCount(), mesh);
+	return true;
+}
+
+static bool loadMeshOBJ(const char * path, Mesh & mesh){
+	IndexedMesh indexed;
+	if (!loadOBJIndexed(path, indexed))
+		return false;
+
+	expandIndexed(indexed.vertices.data(), indexed.uvs.data(), indexed.normals.data(), indexed.indices.data(),
+		indexed.indices.size(), mesh);
+	return true;
+}
+
+static bool isMeshBinary(const char * path){
+	size_t length = strlen(path);
+	return length >= 5 && strcmp(path + length - 5, ".mesh") == 0;
+}
+
+std::shared_ptr<const Mesh> loadCachedMesh(const char * path){
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	auto it = cache.find(path);
+	if (it != cache.end())
+		return it->second;
+
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+	bool loaded = isMeshBinary(path)
+		? loadMeshBinary(path, *mesh)
+		: loadMeshOBJ(path, *mesh);
+	if (!loaded)
+		return nullptr;
+
+	cache[path] = mesh;
+	return mesh;
+}
+
+template<size_t N>
+static std::shared_ptr<const Mesh> toMesh(const PrimitiveMesh<N> & primitive){
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+	mesh->vertices.reserve(N);
+	mesh->uvs.reserve(N);
+	mesh->normals.reserve(N);
+	for (const PrimitiveVertex & v : primitive.vertices){
+		mesh->vertices.push_back(glm::vec3(v.position[0], v.position[1], v.position[2]));
+		mesh->uvs     .push_back(glm::vec2(v.uv[0], v.uv[1]));
+		mesh->normals .push_back(glm::vec3(v.normal[0], v.normal[1], v.normal[2]));
+	}
+	return mesh;
+}
+
+std::shared_ptr<const Mesh> getUnitCubeMesh(){
+	// Only copied into vectors once, the data itself is baked into the binary
+	static const std::shared_ptr<const Mesh> cube = toMesh(unitCube);
+	return cube;
+}
+
+void clearMeshCache(){
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cache.clear();
+}
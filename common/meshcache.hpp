@@ -0,0 +1,26 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// De-indexed triangle mesh as returned by loadOBJ
+struct Mesh {
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+};
+
+// Load a mesh from an OBJ file, or from a binary mesh file if the path ends with ".mesh".
+// Every path is only loaded once, later calls return the same data. Returns nullptr if the file can't be loaded.
+std::shared_ptr<const Mesh> loadCachedMesh(const char * path);
+
+// The compile time unit cube of primitives.hpp, no file needed
+std::shared_ptr<const Mesh> getUnitCubeMesh();
+
+// Drop all cached meshes. Meshes still in use stay valid until they are released.
+void clearMeshCache();
+
+#endif
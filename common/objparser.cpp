@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "objparser.hpp"
+
+// Hand written replacement for the fscanf based loadOBJ. Everything works on one buffer,
+// numbers are parsed in place and corners are merged through a table chained by position.
+
+namespace {
+
+struct Corner {
+	int32_t v, t, n;
+};
+
+// Maps (position, uv, normal) index triples to output vertices. Corners are chained per position,
+// OBJ files reference positions mostly in order, so the lookups stay close together in memory.
+class CornerTable {
+public:
+	// Returns the output vertex of a corner, inserted is true if it is new
+	uint32_t find(const Corner & c, bool & inserted){
+		if ((size_t) c.v >= head.size())
+			head.resize(c.v + 1 + head.size() / 2, NONE);
+
+		for (uint32_t i = head[c.v]; i != NONE; i = vertices[i].next){
+			if (vertices[i].t == c.t && vertices[i].n == c.n){
+				inserted = false;
+				return i;
+			}
+		}
+
+		uint32_t index = (uint32_t) vertices.size();
+		vertices.push_back(Entry{c.t, c.n, head[c.v]});
+		head[c.v] = index;
+		inserted = true;
+		return index;
+	}
+
+private:
+	enum : uint32_t { NONE = 0xFFFFFFFFu };
+
+	struct Entry {
+		int32_t t, n;
+		uint32_t next;
+	};
+
+	std::vector<uint32_t> head;
+	std::vector<Entry> vertices;
+};
+
+inline bool isDigit(char c){
+	return c >= '0' && c <= '9';
+}
+
+inline void skipSpaces(const char *& p, const char * end){
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+}
+
+inline void skipLine(const char *& p, const char * end){
+	const char * newline = (const char *) memchr(p, '\n', end - p);
+	p = newline ? newline + 1 : end;
+}
+
+bool parseFloat(const char *& p, const char * end, float & out){
+	static const double powers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	skipSpaces(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')){
+		negative = *p == '-';
+		p++;
+	}
+
+	// Up to 19 significant digits fit into the mantissa, the rest only moves the exponent
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool any = false;
+	for (; p < end && isDigit(*p); p++, any = true){
+		if (digits < 19){
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0) digits++;
+		}else{
+			exponent++;
+		}
+	}
+	if (p < end && *p == '.'){
+		p++;
+		for (; p < end && isDigit(*p); p++, any = true){
+			if (digits < 19){
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) digits++;
+				exponent--;
+			}
+		}
+	}
+	if (!any)
+		return false;
+
+	if (p < end && (*p == 'e' || *p == 'E')){
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')){
+			negativeExponent = *p == '-';
+			p++;
+		}
+		if (p >= end || !isDigit(*p))
+			return false;
+		int e = 0;
+		for (; p < end && isDigit(*p); p++)
+			if (e < 10000) e = e * 10 + (*p - '0');
+		exponent += negativeExponent ? -e : e;
+	}
+
+	double value = (double) mantissa;
+	if (exponent < 0 && exponent >= -22)
+		value /= powers[-exponent];
+	else if (exponent > 0 && exponent <= 22)
+		value *= powers[exponent];
+	else if (exponent != 0)
+		value *= pow(10.0, exponent);
+
+	out = (float) (negative ? -value : value);
+	return true;
+}
+
+bool parseInt(const char *& p, const char * end, int64_t & out){
+	bool negative = false;
+	if (p < end && *p == '-'){
+		negative = true;
+		p++;
+	}
+	if (p >= end || !isDigit(*p))
+		return false;
+	int64_t value = 0;
+	for (; p < end && isDigit(*p); p++)
+		if (value < ((int64_t) 1 << 40)) value = value * 10 + (*p - '0');
+	out = negative ? -value : value;
+	return true;
+}
+
+// Turn a 1-based or negative OBJ index into a 0-based one, -1 if it is out of range
+inline int32_t resolveIndex(int64_t index, size_t count){
+	int64_t resolved = index > 0 ? index - 1 : (int64_t) count + index;
+	return index != 0 && resolved >= 0 && resolved < (int64_t) count ? (int32_t) resolved : -1;
+}
+
+// Parse "v", "v/vt", "v//vn" or "v/vt/vn". Missing attributes are -1.
+bool parseCorner(const char *& p, const char * end, size_t numPositions, size_t numUvs, size_t numNormals,
+		Corner & corner){
+	int64_t index;
+	if (!parseInt(p, end, index) || (corner.v = resolveIndex(index, numPositions)) < 0)
+		return false;
+	corner.t = -1;
+	corner.n = -1;
+	if (p >= end || *p != '/')
+		return true;
+	p++;
+	if (p < end && *p != '/'){
+		if (!parseInt(p, end, index) || (corner.t = resolveIndex(index, numUvs)) < 0)
+			return false;
+	}
+	if (p >= end || *p != '/')
+		return true;
+	p++;
+	return parseInt(p, end, index) && (corner.n = resolveIndex(index, numNormals)) >= 0;
+}
+
+}
+
+bool parseOBJ(const char * data, size_t size, IndexedMesh & out){
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<Corner> face;
+
+	out.vertices.clear();
+	out.uvs.clear();
+	out.normals.clear();
+	out.indices.clear();
+
+	// Rough guesses from typical files, everything still grows on demand
+	CornerTable table;
+	positions.reserve(size / 128);
+	out.indices.reserve(size / 16);
+
+	const char * p = data;
+	const char * end = data + size;
+	size_t line = 1;
+	int32_t faceNumber = 0;
+
+	for (; p < end; line++){
+		skipSpaces(p, end);
+		if (p >= end)
+			break;
+
+		bool ok = true;
+		if (p[0] == 'v' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')){
+			p += 1;
+			glm::vec3 v;
+			ok = parseFloat(p, end, v.x) && parseFloat(p, end, v.y) && parseFloat(p, end, v.z);
+			positions.push_back(v);
+		}else if (p[0] == 'v' && p + 2 < end && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')){
+			p += 2;
+			// One to three coordinates, a missing v is 0 and w is ignored
+			glm::vec2 uv(0);
+			ok = parseFloat(p, end, uv.x);
+			skipSpaces(p, end);
+			if (ok && p < end && *p != '\n' && *p != '#')
+				ok = parseFloat(p, end, uv.y);
+			uv.y = -uv.y; // Same convention as loadOBJ
+			uvs.push_back(uv);
+		}else if (p[0] == 'v' && p + 2 < end && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')){
+			p += 2;
+			glm::vec3 n;
+			ok = parseFloat(p, end, n.x) && parseFloat(p, end, n.y) && parseFloat(p, end, n.z);
+			normals.push_back(n);
+		}else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')){
+			p += 1;
+			face.clear();
+			bool needsNormal = false;
+			for (;;){
+				skipSpaces(p, end);
+				if (p >= end || *p == '\n' || *p == '#')
+					break;
+				Corner corner;
+				if (!parseCorner(p, end, positions.size(), uvs.size(), normals.size(), corner)){
+					ok = false;
+					break;
+				}
+				needsNormal |= corner.n < 0;
+				face.push_back(corner);
+			}
+			ok = ok && face.size() >= 3;
+
+			glm::vec3 flatNormal(0);
+			if (ok && needsNormal){
+				// Newell's method, also works for n-gons that are not perfectly planar
+				for (size_t i = 0; i < face.size(); i++){
+					glm::vec3 a = positions[face[i].v];
+					glm::vec3 b = positions[face[(i + 1) % face.size()].v];
+					flatNormal += glm::vec3((a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y));
+				}
+				float length = glm::length(flatNormal);
+				if (length > 0) flatNormal /= length;
+			}
+
+			uint32_t first = 0, previous = 0;
+			for (size_t i = 0; ok && i < face.size(); i++){
+				Corner key = face[i];
+				// Flat normals belong to one face, so only corners of the same face are merged
+				if (key.n < 0) key.n = -2 - faceNumber;
+
+				bool inserted;
+				uint32_t index = table.find(key, inserted);
+				if (inserted){
+					out.vertices.push_back(positions[key.v]);
+					out.uvs.push_back(key.t >= 0 ? uvs[key.t] : glm::vec2(0));
+					out.normals.push_back(key.n >= 0 ? normals[key.n] : flatNormal);
+				}
+
+				if (i == 0){
+					first = index;
+				}else if (i >= 2){
+					out.indices.push_back(first);
+					out.indices.push_back(previous);
+					out.indices.push_back(index);
+				}
+				previous = index;
+			}
+			faceNumber++;
+		}
+
+		if (!ok){
+			printf("Malformed OBJ data in line %zu\n", line);
+			return false;
+		}
+
+		// Comments, groups, materials and whatever follows the values are ignored
+		skipLine(p, end);
+	}
+
+	return true;
+}
+
+bool loadOBJIndexed(const char * path, IndexedMesh & out){
+	FILE * file = fopen(path, "rb");
+	if (file == NULL){
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+
+	std::vector<char> data;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size > 0){
+		data.resize((size_t) size);
+		if (fread(data.data(), 1, data.size(), file) != data.size()){
+			printf("Failed to read %s\n", path);
+			fclose(file);
+			return false;
+		}
+	}
+	fclose(file);
+
+	return parseOBJ(data.data(), data.size(), out);
+}
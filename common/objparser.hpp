@@ -0,0 +1,29 @@
+#ifndef OBJPARSER_HPP
+#define OBJPARSER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Indexed triangle mesh, every vertex is a unique combination of position, uv and normal
+struct IndexedMesh {
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> indices;
+};
+
+// Parse an OBJ file that is already in memory.
+// - Faces can have any number of corners and are triangulated as a fan.
+// - Corners can be "v", "v/vt", "v//vn" or "v/vt/vn", negative indices count from the end.
+// - Missing uvs are zero, missing normals are replaced by the flat normal of the face.
+// - Identical corners are merged into one vertex.
+// The V coordinate is inverted like loadOBJ does. Returns false on malformed input.
+bool parseOBJ(const char * data, size_t size, IndexedMesh & out);
+
+// Read a whole OBJ file and parse it with parseOBJ
+bool loadOBJIndexed(const char * path, IndexedMesh & out);
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "offscreencontext.hpp"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// Extension lists are separated by spaces, a plain strstr would also match longer names
+static bool hasExtension(const char * extensions, const char * name){
+	size_t length = strlen(name);
+	for (const char * found = extensions ? strstr(extensions, name) : NULL; found; found = strstr(found + length, name)){
+		if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+			return true;
+	}
+	return false;
+}
+
+static EGLDisplay openDisplay(){
+	// The surfaceless platform needs no X or Wayland server, EGL_NO_DISPLAY queries the client extensions
+	const char * clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")){
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+			return display;
+	}
+
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+		return display;
+	return EGL_NO_DISPLAY;
+}
+
+bool OffscreenContext::initialize(int width, int height, int samples){
+	this->width = width;
+	this->height = height;
+	this->samples = samples;
+
+	display = openDisplay();
+	if (display == EGL_NO_DISPLAY){
+		fprintf(stderr, "Failed to open an EGL display\n");
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)){
+		fprintf(stderr, "EGL has no desktop OpenGL\n");
+		release();
+		return false;
+	}
+
+	// The surfaceless platform may have no configs at all, its contexts are then created without one
+	const char * extensions = eglQueryString(display, EGL_EXTENSIONS);
+	bool surfaceless = hasExtension(extensions, "EGL_KHR_surfaceless_context");
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = (EGLConfig) 0;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0){
+		if (!surfaceless || !hasExtension(extensions, "EGL_KHR_no_config_context")){
+			fprintf(stderr, "No EGL config for OpenGL\n");
+			release();
+			return false;
+		}
+		config = (EGLConfig) 0;
+	}
+
+	// Same version and profile as the window
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT){
+		fprintf(stderr, "Failed to create an OpenGL 3.3 context, EGL error 0x%x\n", eglGetError());
+		release();
+		return false;
+	}
+
+	// Everything is drawn into the framebuffer object, a pbuffer is only made where a context needs a surface
+	if (!surfaceless){
+		const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+		surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+	}
+	if (!eglMakeCurrent(display, surface, surface, context)){
+		fprintf(stderr, "Failed to make the EGL context current, EGL error 0x%x\n", eglGetError());
+		release();
+		return false;
+	}
+
+	glewExperimental = true; // Needed for core profile
+	if (glewInit() != GLEW_OK){
+		fprintf(stderr, "Failed to initialize GLEW\n");
+		release();
+		return false;
+	}
+
+	glGenRenderbuffers(1, &colorbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorbuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depthbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthbuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+		fprintf(stderr, "Offscreen framebuffer is incomplete\n");
+		release();
+		return false;
+	}
+
+	// Multisampled pixels can't be read directly
+	if (samples > 0){
+		glGenRenderbuffers(1, &resolveColorbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, resolveColorbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenFramebuffers(1, &resolveFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColorbuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void OffscreenContext::release(){
+	if (context != EGL_NO_CONTEXT){
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteFramebuffers(1, &resolveFramebuffer);
+		glDeleteRenderbuffers(1, &colorbuffer);
+		glDeleteRenderbuffers(1, &depthbuffer);
+		glDeleteRenderbuffers(1, &resolveColorbuffer);
+		framebuffer = resolveFramebuffer = colorbuffer = depthbuffer = resolveColorbuffer = 0;
+
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		context = EGL_NO_CONTEXT;
+	}
+	if (surface != EGL_NO_SURFACE){
+		eglDestroySurface(display, surface);
+		surface = EGL_NO_SURFACE;
+	}
+	if (display != EGL_NO_DISPLAY){
+		eglTerminate(display);
+		display = EGL_NO_DISPLAY;
+	}
+}
+
+void OffscreenContext::readPixels(unsigned char * pixels){
+	GLuint source = framebuffer;
+	if (samples > 0){
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		source = resolveFramebuffer;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+uint64_t OffscreenContext::checksum(){
+	std::vector<unsigned char> pixels((size_t) width * height * 4);
+	readPixels(pixels.data());
+
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned char pixel : pixels){
+		hash ^= pixel;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool OffscreenContext::writeImage(const char * path){
+	std::vector<unsigned char> pixels((size_t) width * height * 4);
+	readPixels(pixels.data());
+
+	FILE * file = fopen(path, "wb");
+	if (file == NULL){
+		fprintf(stderr, "Can't write %s\n", path);
+		return false;
+	}
+
+	// PPM rows go top down and have no alpha
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	std::vector<unsigned char> row((size_t) width * 3);
+	for (int y = height - 1; y >= 0; y--){
+		const unsigned char * source = &pixels[(size_t) y * width * 4];
+		for (int x = 0; x < width; x++){
+			row[x * 3] = source[x * 4];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + 2];
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,40 @@
+#ifndef OFFSCREENCONTEXT_HPP
+#define OFFSCREENCONTEXT_HPP
+
+#include <stdint.h>
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+
+// OpenGL 3.3 core context without window or display server, created through EGL. Mesa's surfaceless platform
+// is tried first, so it runs on servers without GPU on the software rasterizer, the default display with a
+// small pbuffer otherwise. Frames are drawn into a framebuffer object that stays bound.
+class OffscreenContext {
+public:
+	// Create the context, make it current, initialize GLEW and bind a framebuffer of width x height pixels
+	// with samples samples per pixel, 0 for none
+	bool initialize(int width, int height, int samples);
+
+	void release();
+
+	// FNV-1a hash of the RGBA pixels of the framebuffer, equal images give equal hashes
+	uint64_t checksum();
+
+	// Write the framebuffer as binary PPM
+	bool writeImage(const char * path);
+
+private:
+	// Read the pixels bottom row first, multisampled framebuffers are resolved first
+	void readPixels(unsigned char * pixels);
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+	EGLSurface surface = EGL_NO_SURFACE;
+
+	// Framebuffer that is drawn to and the single sampled one it is resolved into
+	GLuint framebuffer = 0, colorbuffer = 0, depthbuffer = 0;
+	GLuint resolveFramebuffer = 0, resolveColorbuffer = 0;
+	int width = 0, height = 0, samples = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include <math.h>
+#include <string.h>
+#include <map>
+#include <utility>
+
+#include "packedmesh.hpp"
+
+int16_t packSnorm16(float value){
+	value = value < -1 ? -1 : value > 1 ? 1 : value;
+	return (int16_t) lroundf(value * 32767.f);
+}
+
+uint32_t packNormal(glm::vec3 normal){
+	uint32_t packed = 0;
+	for (int axis = 0; axis < 3; axis++){
+		float value = normal[axis] < -1 ? -1 : normal[axis] > 1 ? 1 : normal[axis];
+		int32_t component = (int32_t) lroundf(value * 511.f);
+		packed |= ((uint32_t) component & 0x3FFu) << (10 * axis);
+	}
+	return packed;
+}
+
+bool appendPackedMesh(const Mesh & mesh, PackedMesh & packed, PackedMeshRange & range){
+	// Every axis is normalized on its own, a mesh that is flat on one axis keeps a scale of 1 there
+	glm::vec3 scale(0);
+	for (const glm::vec3 & vertex : mesh.vertices)
+		scale = glm::max(scale, glm::abs(vertex));
+	for (int axis = 0; axis < 3; axis++)
+		if (scale[axis] == 0) scale[axis] = 1;
+
+	size_t firstVertex = packed.vertices.size();
+	std::vector<PackedVertex> vertices;
+	std::vector<uint16_t> indices;
+	indices.reserve(mesh.vertices.size());
+
+	// De-indexed triangles repeat every corner, equal quantized vertices become one
+	std::map<std::pair<uint64_t, uint32_t>, uint16_t> merged;
+	for (size_t i = 0; i < mesh.vertices.size(); i++){
+		PackedVertex vertex;
+		for (int axis = 0; axis < 3; axis++)
+			vertex.position[axis] = packSnorm16(mesh.vertices[i][axis] / scale[axis]);
+		vertex.position[3] = 32767;
+		vertex.normal = packNormal(mesh.normals[i]);
+
+		uint64_t position;
+		memcpy(&position, vertex.position, sizeof(position));
+		auto inserted = merged.insert(std::make_pair(std::make_pair(position, vertex.normal), (uint16_t) 0));
+		if (inserted.second){
+			if (firstVertex + vertices.size() > 0xFFFF)
+				return false;
+			inserted.first->second = (uint16_t) (firstVertex + vertices.size());
+			vertices.push_back(vertex);
+		}
+		indices.push_back(inserted.first->second);
+	}
+
+	range.firstIndex = packed.indices.size();
+	range.indexCount = indices.size();
+	range.scale = scale;
+	packed.vertices.insert(packed.vertices.end(), vertices.begin(), vertices.end());
+	packed.indices.insert(packed.indices.end(), indices.begin(), indices.end());
+	return true;
+}
+
+size_t packedMeshBytes(const PackedMesh & packed){
+	return packed.vertices.size() * sizeof(PackedVertex) + packed.indices.size() * sizeof(uint16_t);
+}
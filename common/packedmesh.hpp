@@ -0,0 +1,44 @@
+#ifndef PACKEDMESH_HPP
+#define PACKEDMESH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "meshcache.hpp"
+
+// Interleaved vertex with quantized attributes, 12 bytes instead of the 24 of two float vec3.
+// The position is a normalized short per axis relative to the scale of its mesh, the fourth short only
+// keeps the normal 4 byte aligned. The normal is signed 2_10_10_10 with x in the lowest bits, as
+// GL_INT_2_10_10_10_REV expects. Snorm values are encoded as value * 32767.
+struct PackedVertex {
+	int16_t position[4];
+	uint32_t normal;
+};
+
+// Vertices and 16 bit indices of one or more meshes sharing a vertex and an index buffer
+struct PackedMesh {
+	std::vector<PackedVertex> vertices;
+	std::vector<uint16_t> indices;
+};
+
+// Where a mesh is in a PackedMesh. Positions have to be multiplied by scale to get the original ones.
+struct PackedMeshRange {
+	size_t firstIndex;
+	size_t indexCount;
+	glm::vec3 scale;
+};
+
+int16_t packSnorm16(float value);
+uint32_t packNormal(glm::vec3 normal);
+
+// Quantize a de-indexed mesh, merge equal vertices and append it to packed.
+// Returns false if the vertices don't fit 16 bit indices anymore, packed is unchanged then.
+bool appendPackedMesh(const Mesh & mesh, PackedMesh & packed, PackedMeshRange & range);
+
+// Size of the vertex and index data, for comparison with vertices * 2 * sizeof(glm::vec3) before packing
+size_t packedMeshBytes(const PackedMesh & packed);
+
+#endif
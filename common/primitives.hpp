@@ -0,0 +1,55 @@
+#ifndef PRIMITIVES_HPP
+#define PRIMITIVES_HPP
+
+#include <stddef.h>
+
+// Meshes that are generated by the compiler, so they need neither a file nor any work at startup.
+// The layout matches what loadOBJ returns : de-indexed triangles with one normal and uv per vertex.
+
+struct PrimitiveVertex {
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+template<size_t N>
+struct PrimitiveMesh {
+	static constexpr size_t size = N;
+	PrimitiveVertex vertices[N];
+};
+
+// Cube spanning [-1, 1] on every axis, same as cube.obj. Triangles are counter clockwise seen from outside.
+constexpr PrimitiveMesh<36> makeUnitCube(){
+	PrimitiveMesh<36> cube{};
+	const float corners[6][2] = { {-1,-1}, {1,-1}, {1,1}, {-1,-1}, {1,1}, {-1,1} };
+
+	size_t i = 0;
+	for (int axis = 0; axis < 3; axis++){
+		// u and v span the face, u x v points along +axis
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+		for (int side = 0; side < 2; side++){
+			float sign = side == 0 ? 1.f : -1.f;
+			for (int c = 0; c < 6; c++){
+				// Mirror the face on the negative side to keep the winding facing outwards
+				float cu = corners[c][0] * sign;
+				float cv = corners[c][1];
+
+				PrimitiveVertex & vertex = cube.vertices[i++];
+				vertex.position[axis] = sign;
+				vertex.position[u] = cu;
+				vertex.position[v] = cv;
+				vertex.normal[axis] = sign;
+				vertex.uv[0] = (cu + 1) / 2;
+				vertex.uv[1] = (cv + 1) / 2;
+			}
+		}
+	}
+	return cube;
+}
+
+constexpr PrimitiveMesh<36> unitCube = makeUnitCube();
+
+static_assert(unitCube.vertices[0].normal[0] == 1 && unitCube.vertices[35].position[2] == -1, "unit cube is generated at compile time");
+
+#endif
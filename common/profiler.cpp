@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "profiler.hpp"
+
+Profiler::Profiler(size_t historyFrames)
+	: frames(std::max<size_t>(historyFrames, gpuLatency + 2)), startTime(0){
+	startTime = now();
+}
+
+double Profiler::now() const{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count() - startTime;
+}
+
+void Profiler::initializeGpu(){
+	gpuEnabled = true;
+}
+
+void Profiler::releaseGpu(){
+	if (!gpuEnabled)
+		return;
+
+	for (size_t slot = 0; slot < gpuLatency; slot++){
+		for (const PendingQuery & pendingQuery : pending[slot])
+			freeQueries.push_back(pendingQuery.query);
+		pending[slot].clear();
+	}
+	if (!freeQueries.empty())
+		glDeleteQueries((GLsizei) freeQueries.size(), freeQueries.data());
+	freeQueries.clear();
+	gpuEnabled = false;
+}
+
+void Profiler::beginFrame(){
+	// The queries of this slot were issued gpuLatency frames ago
+	resolveQueries(frameNumber % gpuLatency);
+
+	FrameProfile & frame = frames[frameNumber % frames.size()];
+	frame.frame = frameNumber;
+	frame.start = now();
+	frame.duration = -1;
+	frame.events.clear();
+	depth = 0;
+}
+
+void Profiler::endFrame(){
+	FrameProfile & frame = frames[frameNumber % frames.size()];
+	frame.duration = now() - frame.start;
+	frameNumber++;
+	finishedFrames++;
+}
+
+size_t Profiler::beginCpu(const char * name){
+	std::vector<ProfileEvent> & events = frames[frameNumber % frames.size()].events;
+	events.push_back(ProfileEvent{name, now(), -1, false, depth++});
+	return events.size() - 1;
+}
+
+void Profiler::endCpu(size_t section){
+	ProfileEvent & event = frames[frameNumber % frames.size()].events[section];
+	event.duration = now() - event.start;
+	depth--;
+}
+
+void Profiler::beginGpu(const char * name){
+	if (!gpuEnabled || gpuOpen)
+		return;
+
+	GLuint query;
+	if (freeQueries.empty()){
+		glGenQueries(1, &query);
+	} else {
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+
+	std::vector<ProfileEvent> & events = frames[frameNumber % frames.size()].events;
+	events.push_back(ProfileEvent{name, now(), -1, true, depth});
+	pending[frameNumber % gpuLatency].push_back(PendingQuery{frameNumber, events.size() - 1, query});
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	gpuOpen = true;
+}
+
+void Profiler::endGpu(){
+	if (!gpuOpen)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuOpen = false;
+}
+
+FrameProfile * Profiler::findFrame(uint64_t frame){
+	FrameProfile & candidate = frames[frame % frames.size()];
+	return candidate.frame == frame ? &candidate : nullptr;
+}
+
+void Profiler::resolveQueries(size_t slot){
+	for (const PendingQuery & pendingQuery : pending[slot]){
+		// Results that still aren't there are dropped rather than waited for
+		GLint available = 0;
+		glGetQueryObjectiv(pendingQuery.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+		// Some drivers return a timestamp instead of the elapsed time for the first queries of a context, the
+		// first frames are still warming up anyway
+		FrameProfile * frame = findFrame(pendingQuery.frame);
+		if (available && frame && pendingQuery.frame >= gpuLatency){
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(pendingQuery.query, GL_QUERY_RESULT, &elapsed);
+			frame->events[pendingQuery.event].duration = elapsed * 1e-9;
+		}
+		freeQueries.push_back(pendingQuery.query);
+	}
+	pending[slot].clear();
+}
+
+size_t Profiler::getFrameCount() const{
+	// The oldest slot is overwritten by the frame in progress
+	return std::min(finishedFrames, frames.size() - 1);
+}
+
+const FrameProfile * Profiler::getFrame(size_t age) const{
+	if (age >= getFrameCount())
+		return nullptr;
+	return &frames[(frameNumber - 1 - age) % frames.size()];
+}
+
+bool Profiler::writeChromeTrace(const char * path) const{
+	FILE * file = fopen(path, "w");
+	if (file == NULL){
+		printf("Impossible to open %s for writing\n", path);
+		return false;
+	}
+
+	// CPU sections on thread 1, GPU passes on thread 2. Times are in microseconds.
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for (size_t age = getFrameCount(); age-- > 0;){
+		const FrameProfile & frame = *getFrame(age);
+		fprintf(file, ",\n{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"frame\":%llu}}", frame.start * 1e6, frame.duration * 1e6, (unsigned long long) frame.frame);
+		for (const ProfileEvent & event : frame.events){
+			if (event.duration < 0)
+				continue;
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				event.name, event.gpu ? 2 : 1, event.start * 1e6, event.duration * 1e6);
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+void Profiler::printSummary() const{
+	size_t count = getFrameCount();
+	if (count == 0)
+		return;
+
+	struct SectionStats {
+		double total = 0;
+		double max = 0;
+		size_t count = 0;
+	};
+	std::vector<double> frameTimes;
+	std::map<std::string, SectionStats> sections;
+	for (size_t age = 0; age < count; age++){
+		const FrameProfile & frame = *getFrame(age);
+		frameTimes.push_back(frame.duration);
+		for (const ProfileEvent & event : frame.events){
+			if (event.duration < 0)
+				continue;
+			SectionStats & stats = sections[std::string(event.gpu ? "gpu " : "cpu ") + event.name];
+			stats.total += event.duration;
+			stats.max = std::max(stats.max, event.duration);
+			stats.count++;
+		}
+	}
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	auto percentile = [&](double p){ return frameTimes[(size_t) (p * (frameTimes.size() - 1))] * 1e3; };
+	printf("%zu frames : p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", count,
+		percentile(.5), percentile(.95), percentile(.99), frameTimes.back() * 1e3);
+	for (const auto & section : sections){
+		printf("  %-24s mean %8.3f ms  max %8.3f ms\n", section.first.c_str(),
+			section.second.total / section.second.count * 1e3, section.second.max * 1e3);
+	}
+}
+
+ProfileScope::ProfileScope(Profiler & profiler, const char * name, bool gpu)
+	: profiler(profiler), section(profiler.beginCpu(name)), gpu(gpu){
+	if (gpu)
+		profiler.beginGpu(name);
+}
+
+ProfileScope::~ProfileScope(){
+	if (gpu)
+		profiler.endGpu();
+	profiler.endCpu(section);
+}
@@ -0,0 +1,102 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+// One timed section of a frame. Times are in seconds since the profiler was created, a GPU section
+// starts when its commands were issued and has a negative duration while the query result is pending, or if the
+// result was lost or belongs to one of the first frames.
+struct ProfileEvent {
+	const char * name;
+	double start;
+	double duration;
+	bool gpu;
+	int depth;
+};
+
+struct FrameProfile {
+	uint64_t frame;
+	double start;
+	double duration;
+	std::vector<ProfileEvent> events;
+};
+
+// Frame profiler with nested CPU sections and GL_TIME_ELAPSED queries around draw passes.
+// The last frames are kept in a ring, so spikes can be inspected after they happened. GPU results are read
+// a few frames later to never stall the pipeline. Section names must be string literals.
+class Profiler {
+public:
+	explicit Profiler(size_t historyFrames = 600);
+
+	// Create and delete the timer queries, needs a current GL context
+	void initializeGpu();
+	void releaseGpu();
+
+	void beginFrame();
+	void endFrame();
+
+	// Returns the section to pass to endCpu
+	size_t beginCpu(const char * name);
+	void endCpu(size_t section);
+
+	// Timer queries can't be nested, only one GPU section may be open at a time
+	void beginGpu(const char * name);
+	void endGpu();
+
+	// Finished frames, 0 is the last one. Returns nullptr if the frame is no longer kept.
+	const FrameProfile * getFrame(size_t age) const;
+	size_t getFrameCount() const;
+
+	// Write the kept frames as Chrome trace events, viewable in chrome://tracing or Perfetto
+	bool writeChromeTrace(const char * path) const;
+
+	// Print frame time percentiles and the mean and max of every section over the kept frames
+	void printSummary() const;
+
+private:
+	struct PendingQuery {
+		uint64_t frame;
+		size_t event;
+		GLuint query;
+	};
+
+	// Frames a query result is waited for before the slot is reused
+	static const size_t gpuLatency = 4;
+
+	double now() const;
+	FrameProfile * findFrame(uint64_t frame);
+	void resolveQueries(size_t slot);
+
+	std::vector<FrameProfile> frames;
+	uint64_t frameNumber = 0;
+	size_t finishedFrames = 0;
+	int depth = 0;
+	bool gpuEnabled = false;
+
+	// Queries issued per in-flight frame, and the ones not yet in use
+	std::vector<PendingQuery> pending[gpuLatency];
+	std::vector<GLuint> freeQueries;
+	bool gpuOpen = false;
+	double startTime;
+};
+
+// Times the enclosing block on the CPU, and on the GPU too if gpu is set
+class ProfileScope {
+public:
+	ProfileScope(Profiler & profiler, const char * name, bool gpu = false);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope &) = delete;
+	ProfileScope & operator=(const ProfileScope &) = delete;
+
+private:
+	Profiler & profiler;
+	size_t section;
+	bool gpu;
+};
+
+#endif
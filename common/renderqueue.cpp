@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include "renderqueue.hpp"
+
+static size_t indexSize(GLenum indexType){
+	return indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+size_t RenderQueue::addProgram(GLuint program, ProgramSetup setup, MaterialSetup material){
+	programs.push_back(Program{program, setup, material});
+	return programs.size() - 1;
+}
+
+void RenderQueue::setProgram(size_t handle, GLuint program){
+	programs[handle].program = program;
+}
+
+size_t RenderQueue::addVertexArray(GLuint vertexBuffer, const std::vector<VertexAttribute> & vertexAttributes,
+		GLuint indexBuffer, GLenum indexType,
+		GLuint instanceBuffer, const std::vector<VertexAttribute> & instanceAttributes){
+	VertexArray vertexArray{0, indexType, instanceBuffer, instanceAttributes, 0};
+	glGenVertexArrays(1, &vertexArray.vertexArray);
+	glBindVertexArray(vertexArray.vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	for (const VertexAttribute & attribute : vertexAttributes){
+		glEnableVertexAttribArray(attribute.location);
+		glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+			attribute.stride, (void *) attribute.offset);
+	}
+
+	for (const VertexAttribute & attribute : instanceAttributes){
+		glEnableVertexAttribArray(attribute.location);
+		glVertexAttribDivisor(attribute.location, 1);
+	}
+	pointInstances(vertexArray, 0);
+
+	// The index buffer binding is part of the vertex array
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(0);
+
+	vertexArrays.push_back(vertexArray);
+	return vertexArrays.size() - 1;
+}
+
+void RenderQueue::pointInstances(VertexArray & vertexArray, GLuint firstInstance){
+	if (vertexArray.instanceAttributes.empty())
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexArray.instanceBuffer);
+	for (const VertexAttribute & attribute : vertexArray.instanceAttributes){
+		size_t offset = attribute.offset + (size_t) firstInstance * attribute.stride;
+		glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+			attribute.stride, (void *) offset);
+	}
+	vertexArray.firstInstance = firstInstance;
+}
+
+void RenderQueue::submit(const DrawItem & item){
+	items.push_back(item);
+}
+
+void RenderQueue::flush(){
+	// Stable, so draws with equal state keep the order they were submitted in
+	std::stable_sort(items.begin(), items.end(), [](const DrawItem & a, const DrawItem & b){
+		if (a.program != b.program) return a.program < b.program;
+		if (a.vertexArray != b.vertexArray) return a.vertexArray < b.vertexArray;
+		return a.material < b.material;
+	});
+
+	// Without ARB_base_instance the instance attributes are moved to the first instance instead
+	bool baseInstance = GLEW_ARB_base_instance != 0;
+
+	drawCalls = 0;
+	stateChanges = 0;
+	const DrawItem * previous = nullptr;
+	for (const DrawItem & item : items){
+		Program & program = programs[item.program];
+		bool programChanged = !previous || previous->program != item.program;
+		if (programChanged){
+			glUseProgram(program.program);
+			if (program.setup) program.setup();
+			stateChanges++;
+		}
+
+		VertexArray & vertexArray = vertexArrays[item.vertexArray];
+		if (!previous || previous->vertexArray != item.vertexArray){
+			glBindVertexArray(vertexArray.vertexArray);
+			stateChanges++;
+		}
+
+		if ((programChanged || previous->material != item.material) && program.material){
+			program.material(item.material);
+			stateChanges++;
+		}
+
+		void * indices = (void *) (item.firstIndex * indexSize(vertexArray.indexType));
+		if (item.instanceCount == 0){
+			glDrawElements(GL_TRIANGLES, item.indexCount, vertexArray.indexType, indices);
+		} else if (baseInstance){
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, item.indexCount, vertexArray.indexType, indices,
+				item.instanceCount, item.firstInstance);
+		} else {
+			if (vertexArray.firstInstance != item.firstInstance)
+				pointInstances(vertexArray, item.firstInstance);
+			glDrawElementsInstanced(GL_TRIANGLES, item.indexCount, vertexArray.indexType, indices, item.instanceCount);
+		}
+		drawCalls++;
+		previous = &item;
+	}
+	items.clear();
+}
+
+void RenderQueue::release(){
+	for (const VertexArray & vertexArray : vertexArrays)
+		glDeleteVertexArrays(1, &vertexArray.vertexArray);
+	vertexArrays.clear();
+	programs.clear();
+	items.clear();
+}
@@ -0,0 +1,91 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+#include <GL/glew.h>
+
+// One vertex attribute as passed to glVertexAttribPointer, offset in bytes into its buffer
+struct VertexAttribute {
+	GLuint location;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	size_t offset;
+};
+
+// One indexed draw. program and vertexArray are handles returned by the queue. With instanceCount 0 the
+// mesh is drawn once without instancing, otherwise instances firstInstance to firstInstance + instanceCount - 1.
+struct DrawItem {
+	size_t program;
+	size_t vertexArray;
+	uint32_t material;
+	GLsizei indexCount;
+	size_t firstIndex;
+	GLsizei instanceCount;
+	GLuint firstInstance;
+};
+
+// Collects the draws of a frame and submits them sorted by program, vertex array and material, so every
+// state is only set once per frame. Vertex arrays are configured once when they are added.
+class RenderQueue {
+public:
+	// Called when a program is bound, to set the uniforms that are the same for all its draws
+	typedef std::function<void()> ProgramSetup;
+	// Called when the material changes within a program
+	typedef std::function<void(uint32_t material)> MaterialSetup;
+
+	// Returns the handle for DrawItem::program. material may be empty.
+	size_t addProgram(GLuint program, ProgramSetup setup, MaterialSetup material = MaterialSetup());
+
+	// Replace the program of a handle, e.g. after it was reloaded. The setup is kept.
+	void setProgram(size_t handle, GLuint program);
+
+	// Create a vertex array for an indexed mesh, with optional per-instance attributes advanced once per
+	// instance. Returns the handle for DrawItem::vertexArray. Needs a current GL context.
+	size_t addVertexArray(GLuint vertexBuffer, const std::vector<VertexAttribute> & vertexAttributes,
+		GLuint indexBuffer, GLenum indexType,
+		GLuint instanceBuffer = 0, const std::vector<VertexAttribute> & instanceAttributes = std::vector<VertexAttribute>());
+
+	void submit(const DrawItem & item);
+
+	// Sort and draw everything that was submitted since the last flush
+	void flush();
+
+	// Delete the vertex arrays
+	void release();
+
+	// Draw calls and state changes of the last flush
+	size_t getDrawCalls() const { return drawCalls; }
+	size_t getStateChanges() const { return stateChanges; }
+
+private:
+	struct Program {
+		GLuint program;
+		ProgramSetup setup;
+		MaterialSetup material;
+	};
+
+	struct VertexArray {
+		GLuint vertexArray;
+		GLenum indexType;
+		GLuint instanceBuffer;
+		std::vector<VertexAttribute> instanceAttributes;
+		// First instance the instance attributes currently point at
+		GLuint firstInstance;
+	};
+
+	void pointInstances(VertexArray & vertexArray, GLuint firstInstance);
+
+	std::vector<Program> programs;
+	std::vector<VertexArray> vertexArrays;
+	std::vector<DrawItem> items;
+	size_t drawCalls = 0;
+	size_t stateChanges = 0;
+};
+
+#endif
@@ -7,41 +7,145 @@
 using namespace std;
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 #include <GL/glew.h>
 
 #include "shader.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+bool ReadShaderFile(const char * file_path, std::string & code){
+	FILE * file = fopen(file_path, "rb");
+	if(file == NULL)
+		return false;
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+	// The whole file in one read
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if(size > 0){
+		size_t start = code.size();
+		code.resize(start + size);
+		code.resize(start + fread(&code[start], 1, size, file));
+	}
+	fclose(file);
+	return true;
+}
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
+// FNV-1a, continued from a previous hash
+static uint64_t HashBytes(uint64_t hash, const void * data, size_t size){
+	const unsigned char * bytes = (const unsigned char *) data;
+	for(size_t i = 0; i < size; i++){
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const char * text){
+	// The terminator separates the strings, so moving text from one to the next changes the hash
+	return HashBytes(hash, text ? text : "", text ? strlen(text) + 1 : 1);
+}
+
+// A shader path with anything but letters, digits and dots replaced, so it can be part of a file name
+static std::string FileNamePart(const char * file_path){
+	std::string part = file_path;
+	for(char & c : part){
+		if(!isalnum((unsigned char) c) && c != '.')
+			c = '_';
+	}
+	return part;
+}
+
+static bool ProgramBinarySupported(){
+	if(!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+struct ProgramBinaryHeader {
+	char magic[4];
+	uint32_t format;
+	uint64_t key;
+};
+
+static GLuint LoadProgramBinary(const std::string & path, uint64_t key){
+	FILE * file = fopen(path.c_str(), "rb");
+	if(file == NULL)
 		return 0;
+
+	ProgramBinaryHeader header;
+	std::vector<char> binary;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "GJPB", 4) == 0
+		&& header.key == key;
+	if(valid){
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file) - (long) sizeof(header);
+		fseek(file, sizeof(header), SEEK_SET);
+		binary.resize(size > 0 ? size : 0);
+		valid = size > 0 && fread(binary.data(), 1, binary.size(), file) == binary.size();
 	}
+	fclose(file);
+	if(!valid)
+		return 0;
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	// Drivers reject binaries of other versions, then the program is compiled from source again
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, header.format, binary.data(), (GLsizei) binary.size());
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if(Result != GL_TRUE){
+		glDeleteProgram(ProgramID);
+		return 0;
 	}
+	return ProgramID;
+}
+
+static void SaveProgramBinary(GLuint ProgramID, const std::string & directory, const std::string & path, uint64_t key){
+	GLint length = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+		return;
+
+	ProgramBinaryHeader header = {{'G', 'J', 'P', 'B'}, 0, key};
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(ProgramID, length, NULL, &format, binary.data());
+	header.format = format;
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+
+	// Written to a temporary file first, so a crash never leaves a truncated binary behind
+	std::string temporary = path + ".tmp";
+	FILE * file = fopen(temporary.c_str(), "wb");
+	if(file == NULL)
+		return;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+	written = fclose(file) == 0 && written;
+	remove(path.c_str());
+	if(!written || rename(temporary.c_str(), path.c_str()) != 0)
+		remove(temporary.c_str());
+}
+
+static GLuint CompileProgram(const char * vertex_file_path, const std::string & VertexShaderCode,
+		const char * fragment_file_path, const std::string & FragmentShaderCode, bool retrievable){
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
@@ -86,6 +190,8 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	if(retrievable)
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -107,4 +213,46 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	return ProgramID;
 }
 
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * cache_directory){
+
+	// Read the Vertex Shader code from the file
+	std::string VertexShaderCode;
+	if(!ReadShaderFile(vertex_file_path, VertexShaderCode)){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
+		getchar();
+		return 0;
+	}
+
+	// Read the Fragment Shader code from the file
+	std::string FragmentShaderCode;
+	ReadShaderFile(fragment_file_path, FragmentShaderCode);
+
+	bool cached = cache_directory != NULL && ProgramBinarySupported();
+	if(!cached)
+		return CompileProgram(vertex_file_path, VertexShaderCode, fragment_file_path, FragmentShaderCode, false);
+
+	// Binaries only work with the driver that created them, so the driver is part of the key
+	uint64_t key = 0xcbf29ce484222325ULL;
+	key = HashString(key, VertexShaderCode.c_str());
+	key = HashString(key, FragmentShaderCode.c_str());
+	key = HashString(key, (const char *) glGetString(GL_VENDOR));
+	key = HashString(key, (const char *) glGetString(GL_RENDERER));
+	key = HashString(key, (const char *) glGetString(GL_VERSION));
 
+	// One file per program, so edited shaders replace their binary instead of adding one, the key in the header
+	// tells whether it is still current
+	std::string path = std::string(cache_directory) + "/" + FileNamePart(vertex_file_path) + "+"
+		+ FileNamePart(fragment_file_path) + ".bin";
+
+	GLuint ProgramID = LoadProgramBinary(path, key);
+	if(ProgramID != 0)
+		return ProgramID;
+
+	ProgramID = CompileProgram(vertex_file_path, VertexShaderCode, fragment_file_path, FragmentShaderCode, true);
+
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if(Result == GL_TRUE)
+		SaveProgramBinary(ProgramID, cache_directory, path, key);
+	return ProgramID;
+}
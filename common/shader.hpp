@@ -1,6 +1,14 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+#include <string>
+
+// Append the source of a shader file to code, returns false if the file can't be opened
+bool ReadShaderFile(const char * file_path, std::string & code);
+
+// Compile and link a program. With a cache directory, linked programs are stored there as driver binaries
+// and loaded instead of compiled as long as the sources and the driver are unchanged. Each program has one file,
+// which is replaced when its sources change.
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * cache_directory = NULL);
 
 #endif
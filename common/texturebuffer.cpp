@@ -0,0 +1,49 @@
+#include <algorithm>
+
+#include "texturebuffer.hpp"
+
+void TextureBuffer::initialize(GLenum format){
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+
+	// The texture refers to the buffer object, it stays attached when the storage is replaced
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void TextureBuffer::update(const void * data, size_t size){
+	// Empty buffers are not allowed, a few bytes that are never read stand in for them
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(size, 16), NULL, GL_STREAM_DRAW);
+	if (size > 0)
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+}
+
+void TextureBuffer::bind(GLuint unit) const{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
+
+void TextureBuffer::release(){
+	if (texture)
+		glDeleteTextures(1, &texture);
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+	texture = 0;
+	buffer = 0;
+}
+
+bool TextureBuffer::bindSampler(GLuint program, const char * name, GLuint unit){
+	GLint location = glGetUniformLocation(program, name);
+	if (location < 0)
+		return false;
+
+	// Sampler uniforms are only set on the bound program
+	glUseProgram(program);
+	glUniform1i(location, unit);
+	glUseProgram(0);
+	return true;
+}
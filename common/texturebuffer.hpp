@@ -0,0 +1,32 @@
+#ifndef TEXTUREBUFFER_HPP
+#define TEXTUREBUFFER_HPP
+
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+// Buffer texture whose whole contents are replaced every frame, read in shaders with texelFetch. The storage
+// is orphaned on every update, so the driver hands out fresh memory instead of waiting for draws of the
+// previous frames that still read the old contents.
+class TextureBuffer {
+public:
+	// Create buffer and texture for texels of an internal format such as GL_RGBA32F, needs a current GL context
+	void initialize(GLenum format);
+
+	// Replace the contents with size bytes
+	void update(const void * data, size_t size);
+
+	// Bind the texture to a texture unit
+	void bind(GLuint unit) const;
+
+	void release();
+
+	// Set a sampler uniform of a program to a texture unit, false if the program has no such uniform
+	static bool bindSampler(GLuint program, const char * name, GLuint unit);
+
+private:
+	GLuint buffer = 0;
+	GLuint texture = 0;
+};
+
+#endif
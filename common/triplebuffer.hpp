@@ -0,0 +1,41 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <atomic>
+
+// Hands the latest value from one writer thread to one reader thread without locks. The writer fills
+// back() and publishes it, the reader takes the newest published value with update() and reads front().
+// Neither side ever waits, values the reader didn't take in time are skipped.
+template<typename T>
+class TripleBuffer {
+public:
+	// Writer side
+	T & back(){ return slots[backIndex]; }
+
+	void publish(){
+		// The filled slot becomes the middle one, the previous middle slot is written next
+		backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// Reader side, returns false and keeps the current front if nothing new was published
+	bool update(){
+		if (!(middle.load(std::memory_order_relaxed) & fresh))
+			return false;
+		frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	const T & front() const{ return slots[frontIndex]; }
+
+private:
+	static const unsigned indexMask = 3;
+	static const unsigned fresh = 4;
+
+	T slots[3];
+	// Index of the slot between writer and reader, with the fresh bit set while the reader hasn't taken it
+	std::atomic<unsigned> middle{1};
+	unsigned backIndex = 0;
+	unsigned frontIndex = 2;
+};
+
+#endif
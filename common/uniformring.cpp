@@ -0,0 +1,65 @@
+#include <string.h>
+
+#include "uniformring.hpp"
+
+void UniformRing::initialize(size_t blockSize, GLuint binding, size_t slots){
+	this->blockSize = blockSize;
+	this->binding = binding;
+
+	// Every copy has to start at an offset the driver accepts for glBindBufferRange
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	stride = (blockSize + alignment - 1) / alignment * alignment;
+
+	fences.assign(slots, nullptr);
+	slot = slots - 1;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, stride * slots, NULL, GL_DYNAMIC_DRAW);
+}
+
+void UniformRing::update(const void * data){
+	slot = (slot + 1) % fences.size();
+
+	// Only blocks if the GPU is a whole ring behind
+	if (fences[slot]){
+		glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fences[slot]);
+		fences[slot] = nullptr;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	void * mapped = glMapBufferRange(GL_UNIFORM_BUFFER, slot * stride, blockSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped){
+		memcpy(mapped, data, blockSize);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, slot * stride, blockSize);
+}
+
+void UniformRing::fence(){
+	if (fences[slot])
+		glDeleteSync(fences[slot]);
+	fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void UniformRing::release(){
+	for (GLsync & sync : fences){
+		if (sync)
+			glDeleteSync(sync);
+		sync = nullptr;
+	}
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+bool UniformRing::bindBlock(GLuint program, const char * name, GLuint binding){
+	GLuint index = glGetUniformBlockIndex(program, name);
+	if (index == GL_INVALID_INDEX)
+		return false;
+	glUniformBlockBinding(program, index, binding);
+	return true;
+}
@@ -0,0 +1,37 @@
+#ifndef UNIFORMRING_HPP
+#define UNIFORMRING_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Uniform buffer holding a few copies of one uniform block. Every update writes the next copy, so the CPU
+// never waits for draws of the previous frames that still read theirs. A fence per copy guards against
+// the CPU getting more than the number of copies ahead of the GPU.
+class UniformRing {
+public:
+	// Create the buffer for a block of blockSize bytes, needs a current GL context
+	void initialize(size_t blockSize, GLuint binding, size_t slots = 3);
+
+	// Write the next copy and bind it to the binding point
+	void update(const void * data);
+
+	// Call after the last draw that reads the current copy
+	void fence();
+
+	void release();
+
+	// Connect the uniform block called name of a program to a binding point, false if the program has no such block
+	static bool bindBlock(GLuint program, const char * name, GLuint binding);
+
+private:
+	GLuint buffer = 0;
+	GLuint binding = 0;
+	size_t blockSize = 0;
+	size_t stride = 0;
+	size_t slot = 0;
+	std::vector<GLsync> fences;
+};
+
+#endif
@@ -1,16 +1,27 @@
 #include "game.h"
 
 #include <cstdio>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <common/jobsystem.hpp>
 #include <common/shader.hpp>
 #include <iostream>
-#include "common/objloader.hpp"
 
 int Game::width = 1600;
 int Game::height = 900;
 
+// Both threads measure time on this clock, so snapshots can be interpolated by the render thread
+static double steadySeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     // Adjust window scaling
     glViewport(0, 0, width, height);
@@ -20,6 +31,12 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
 
 bool Game::initialize() {
     if (!initializeWindow()) return false;
+    return initializeRendering();
+}
+
+bool Game::initializeRendering() {
+    // Dark blue background
+    glClearColor(0.043f, 0.145f, 0.271f, 0.0f);
 
     initializeWorld();
 
@@ -27,34 +44,137 @@ bool Game::initialize() {
 
     initializeIDs();
 
+    initializeRenderQueue();
+
+    profiler.initializeGpu();
+
     return true;
 }
 
 void Game::run() {
-    updateGameState();
-
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
-    float frameEnd = glfwGetTime();
+    // The render thread has a snapshot from the start, then the simulation takes over player, camera and world
+    updateInput();
+    publishSnapshot(steadySeconds());
+    simulationRunning = true;
+    simulationThread = std::thread(&Game::runSimulation, this);
+
+    double frameEnd = glfwGetTime();
 
     //start animation loop until escape key is pressed
     do {
-        float start = glfwGetTime();
-        deltaTime = start - frameEnd;
+        profiler.beginFrame();
+
+        double start = glfwGetTime();
+        deltaTime = (float) (start - frameEnd);
         frameEnd = start;
 
+        {
+            ProfileScope scope(profiler, "input");
+            updateInput();
+        }
+        {
+            ProfileScope scope(profiler, "snapshot");
+            updateSnapshot();
+        }
+
         updateAnimationLoop();
+
+        profiler.endFrame();
     } // Check if the ESC key was pressed or the window was closed
     while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
            glfwWindowShouldClose(window) == 0);
 
+    simulationRunning = false;
+    simulationThread.join();
 
     //Cleanup and close window
+    cleanup();
+    closeWindow();
+}
+
+void Game::cleanup() {
+    profiler.releaseGpu();
+    renderQueue.release();
+    frameData.release();
+    clusterLights.release();
+    clusterGrid.release();
+    clusterIndices.release();
     cleanupVertexbuffer();
     glDeleteProgram(programID);
-    closeWindow();
+    glDeleteProgram(playerProgramID);
+}
+
+#ifdef JUMP_OFFSCREEN
+bool Game::initializeOffscreen(int frameWidth, int frameHeight) {
+    width = frameWidth;
+    height = frameHeight;
+    if (!offscreen.initialize(width, height, samples)) return false;
+    return initializeRendering();
+}
+
+int Game::runOffscreen(size_t frames, const char *replayFile, const char *imagePath) {
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    // Every frame is kept, so the percentiles cover the whole run
+    profiler = Profiler(frames + 1);
+    profiler.initializeGpu();
+
+    // A replay brings its own world and input, otherwise the camera circles the player on a fixed world
+    if (replayFile) {
+        replayPath = replayFile;
+        startPlayback();
+    } else {
+        resetRun(offscreenSeed, offscreenPlatforms);
+    }
+    if (replayFile && !playback.isOpen()) {
+        cleanup();
+        offscreen.release();
+        return 1;
+    }
+
+    // The snapshots are stamped with the simulated time instead of the clock
+    double simulationTime = 0;
+    publishSnapshot(simulationTime);
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        profiler.beginFrame();
+
+        {
+            ProfileScope scope(profiler, "simulation");
+            simulationInput.cursorX = frame * 8.f;
+            simulationInput.cursorY = 200.f * std::sin(frame * .02f);
+            for (int step = 0; step < offscreenStepsPerFrame; step++) {
+                updateSimulation();
+                simulationTime += simulationStep;
+            }
+            publishSnapshot(simulationTime);
+        }
+        {
+            ProfileScope scope(profiler, "snapshot");
+            updateSnapshot();
+
+            // Drawn at the time of the last step, not interpolated with the clock
+            interpolation = 1;
+        }
+
+        updateAnimationLoop();
+
+        profiler.endFrame();
+    }
+
+    profiler.printSummary();
+    printf("Checksum of the last frame %016llx\n", (unsigned long long) offscreen.checksum());
+    if (imagePath && offscreen.writeImage(imagePath)) printf("Last frame written to %s\n", imagePath);
+
+    cleanup();
+    offscreen.release();
+    return 0;
 }
+#endif
 
 bool Game::initializeWindow() {
     // Initialise GLFW
@@ -64,7 +184,7 @@ bool Game::initializeWindow() {
         return false;
     }
 
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    glfwWindowHint(GLFW_SAMPLES, samples);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
@@ -99,9 +219,6 @@ bool Game::initializeWindow() {
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     glfwSwapInterval(0);
-
-    // Dark blue background
-    glClearColor(0.043f, 0.145f, 0.271f, 0.0f);
     return true;
 }
 
@@ -109,154 +226,399 @@ bool Game::initializeVertexbuffer() {
     glGenVertexArrays(1, &VertexArrayID);
     glBindVertexArray(VertexArrayID);
 
-    glGenBuffers(4, vertexbuffer);
+    glGenBuffers(1, &vertexbuffer);
+    glGenBuffers(1, &indexbuffer);
+    glGenBuffers(2, instancebuffer);
+    glGenBuffers(2, movingbuffer);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[0]);
-    glBufferData(GL_ARRAY_BUFFER, world_vertices.size() * sizeof(glm::vec3), &world_vertices[0], GL_STATIC_DRAW);
+    // Both meshes share one vertex and one index buffer
+    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+    glBufferData(GL_ARRAY_BUFFER, meshes.vertices.size() * sizeof(PackedVertex), meshes.vertices.data(),
+                 GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[1]);
-    glBufferData(GL_ARRAY_BUFFER, world_normals.size() * sizeof(glm::vec3), &world_normals[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexbuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshes.indices.size() * sizeof(uint16_t), meshes.indices.data(),
+                 GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[2]);
-    glBufferData(GL_ARRAY_BUFFER, player_vertices.size() * sizeof(glm::vec3), &player_vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[3]);
-    glBufferData(GL_ARRAY_BUFFER, player_normals.size() * sizeof(glm::vec3), &player_normals[0], GL_STATIC_DRAW);
+    updateInstancebuffer();
 
     return true;
 }
 
+void Game::updateInstancebuffer() {
+    // Platforms are uploaded as they are, position and size are the two per-instance attributes
+    glBindBuffer(GL_ARRAY_BUFFER, instancebuffer[frontInstancebuffer]);
+    glBufferData(GL_ARRAY_BUFFER, drawnWorld->platforms.size() * sizeof(Platform), drawnWorld->platforms.data(),
+                 drawnWorld->endless ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, movingbuffer[frontInstancebuffer]);
+    glBufferData(GL_ARRAY_BUFFER, drawnWorld->movingPlatforms.size() * sizeof(MovingPlatform),
+                 drawnWorld->movingPlatforms.data(), GL_STATIC_DRAW);
+}
+
+void Game::updateStreaming() {
+    // Chunks must stay around the player and its savepoint
+    float lowestY = std::min(player.pos.y, player.getSavedPosition().y);
+    if (world.updateStreaming(lowestY)) worldChanged = true;
+}
+
+void Game::updateWorldGeometry() {
+    std::shared_ptr<WorldGeometry> geometry = std::make_shared<WorldGeometry>();
+    geometry->platforms = world.platforms;
+    geometry->blocks = world.blocks;
+    geometry->movingPlatforms = world.movingPlatforms;
+    geometry->movingBounds = world.movingBounds;
+    geometry->movingBlocks = world.movingBlocks;
+    geometry->endless = world.isEndless();
+    worldGeometry = geometry;
+    worldChanged = false;
+}
+
+void Game::publishSnapshot(double stepTime) {
+    // The copy is only made when the world changed, the game worlds are small enough to copy whole
+    if (worldChanged || !worldGeometry) updateWorldGeometry();
+
+    SimulationSnapshot &snapshot = snapshots.back();
+    snapshot.player = player;
+    snapshot.cam = cam;
+    snapshot.world = worldGeometry;
+    snapshot.stepTime = stepTime;
+    snapshot.motionTime = world.motionTime;
+    snapshots.publish();
+}
+
+void Game::updateSnapshot() {
+    // Without a newer snapshot the last one is drawn again, further interpolated
+    snapshots.update();
+    SimulationSnapshot const &snapshot = snapshots.front();
+    if (snapshot.world != drawnWorld && snapshot.world != uploadingWorld) uploadWorld(snapshot.world);
+    updateUpload();
+
+    interpolation = std::min(1.f, (float) (steadySeconds() - snapshot.stepTime) / simulationStep);
+}
+
+void Game::uploadWorld(std::shared_ptr<const WorldGeometry> const &geometry) {
+    // Streamed chunks of the endless world: only the slots that differ are uploaded, the buffer keeps its size.
+    // Snapshots may have been skipped, so the slots are compared instead of taken from the last update.
+    // Endless worlds have no moving platforms.
+    if (!uploadingWorld && geometry->endless && drawnWorld->endless &&
+        geometry->platforms.size() == drawnWorld->platforms.size()) {
+        glBindBuffer(GL_ARRAY_BUFFER, instancebuffer[frontInstancebuffer]);
+        for (size_t first = 0; first < geometry->platforms.size(); first += World::chunkSize) {
+            if (memcmp(&geometry->platforms[first], &drawnWorld->platforms[first],
+                       World::chunkSize * sizeof(Platform)) == 0)
+                continue;
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Platform), World::chunkSize * sizeof(Platform),
+                            &geometry->platforms[first]);
+        }
+        drawnWorld = geometry;
+        return;
+    }
+
+    // The front buffer is still drawn while the back buffer is filled
+    glBindBuffer(GL_ARRAY_BUFFER, instancebuffer[1 - frontInstancebuffer]);
+    glBufferData(GL_ARRAY_BUFFER, geometry->platforms.size() * sizeof(Platform), geometry->platforms.data(),
+                 geometry->endless ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, movingbuffer[1 - frontInstancebuffer]);
+    glBufferData(GL_ARRAY_BUFFER, geometry->movingPlatforms.size() * sizeof(MovingPlatform),
+                 geometry->movingPlatforms.data(), GL_STATIC_DRAW);
+    if (uploadFence) glDeleteSync(uploadFence);
+    uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    uploadingWorld = geometry;
+}
+
+void Game::updateUpload() {
+    if (!uploadFence) return;
+
+    GLenum status = glClientWaitSync(uploadFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+        glDeleteSync(uploadFence);
+        uploadFence = nullptr;
+
+        // Culling and drawing switch in the same frame, the old front buffer is reused next time
+        drawnWorld = std::move(uploadingWorld);
+        uploadingWorld.reset();
+        frontInstancebuffer = 1 - frontInstancebuffer;
+    }
+}
+
+void Game::startRegeneration() {
+    nextWorld = std::async(std::launch::async, [] {
+        std::unique_ptr<World> generated(new World());
+        generated->initialize();
+        return generated;
+    });
+}
+
+void Game::updateRegeneration() {
+    if (nextWorld.valid() && nextWorld.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        // Collision switches right away, drawing once the render thread has uploaded the new world
+        world = std::move(*nextWorld.get());
+        worldChanged = true;
+    }
+}
+
+bool Game::isRegenerating() const {
+    return nextWorld.valid();
+}
+
+static const char *shaderFiles[] = {"WorldShader.vertexshader", "WorldShader.fragmentshader",
+                                     "PlayerShader.vertexshader", "PlayerShader.fragmentshader"};
+
+static bool isLinked(GLuint program) {
+    GLint linked = GL_FALSE;
+    if (program != 0) glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
 void Game::initializeIDs() {
-    // Create and compile our GLSL program from the shaders
-    programID = LoadShaders("WorldShader.vertexshader", "WorldShader.fragmentshader");
-    playerProgramID = LoadShaders("PlayerShader.vertexshader", "PlayerShader.fragmentshader");
+    // Create and compile our GLSL program from the shaders, or load it from the cache
+    programID = LoadShaders(shaderFiles[0], shaderFiles[1], shaderCacheDirectory);
+    playerProgramID = LoadShaders(shaderFiles[2], shaderFiles[3], shaderCacheDirectory);
+    initializeUniforms();
+    frameData.initialize(sizeof(FrameData), frameDataBinding);
+    clusterLights.initialize(GL_RGBA32F);
+    clusterGrid.initialize(GL_RG32UI);
+    clusterIndices.initialize(GL_R16UI);
+
+    for (const char *file: shaderFiles) {
+        shaderWatcher.watch(file);
+    }
+}
 
-    matrixID = glGetUniformLocation(programID, "MVP");
+void Game::initializeUniforms() {
     modelMatrixID = glGetUniformLocation(programID, "M");
-    viewMatrixID = glGetUniformLocation(programID, "V");
-    playerViewMatrixID = glGetUniformLocation(playerProgramID, "V");
-    lightID = glGetUniformLocation(programID, "LightPosition_worldspace");
-    playerLightID = glGetUniformLocation(programID, "LightPosition_worldspace");
-
+    meshScaleID = glGetUniformLocation(programID, "MeshScale");
+    motionTimeID = glGetUniformLocation(programID, "MotionTime");
     playerModelID = glGetUniformLocation(playerProgramID, "Mp");
-    playerMatrixID = glGetUniformLocation(playerProgramID, "MpVP");
+
+    // Camera and light come from the frame uniform buffer
+    UniformRing::bindBlock(programID, "FrameData", frameDataBinding);
+    UniformRing::bindBlock(playerProgramID, "FrameData", frameDataBinding);
+
+    // Both programs read the lights of their cluster
+    for (GLuint program: {programID, playerProgramID}) {
+        TextureBuffer::bindSampler(program, "ClusterLights", clusterLightsUnit);
+        TextureBuffer::bindSampler(program, "ClusterGrid", clusterGridUnit);
+        TextureBuffer::bindSampler(program, "ClusterIndices", clusterIndicesUnit);
+    }
 }
 
-void Game::updateAnimationLoop() {
-    // Clear the screen
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Game::reloadShaders() {
+    GLuint newProgramID = LoadShaders(shaderFiles[0], shaderFiles[1], shaderCacheDirectory);
+    GLuint newPlayerProgramID = LoadShaders(shaderFiles[2], shaderFiles[3], shaderCacheDirectory);
+    if (!isLinked(newProgramID) || !isLinked(newPlayerProgramID)) {
+        printf("Shader reload failed, keeping the previous shaders\n");
+        glDeleteProgram(newProgramID);
+        glDeleteProgram(newPlayerProgramID);
+        return;
+    }
 
-    // Use our shader
-    glUseProgram(programID);
+    glDeleteProgram(programID);
+    glDeleteProgram(playerProgramID);
+    programID = newProgramID;
+    playerProgramID = newPlayerProgramID;
+    initializeUniforms();
+
+    // The program setups of the render queue read the new uniform locations
+    renderQueue.setProgram(worldProgram, programID);
+    renderQueue.setProgram(playerProgram, playerProgramID);
+    printf("Shaders reloaded\n");
+}
 
-    updateGameState();
+void Game::initializeRenderQueue() {
+    // Both meshes read the same interleaved buffer, the player shader just uses other locations
+    std::vector<VertexAttribute> worldAttributes{
+            {0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, position)},
+            {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, normal)}};
+    std::vector<VertexAttribute> playerAttributes{
+            {2, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, position)},
+            {3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), offsetof(PackedVertex, normal)}};
+
+    // Platform position and size, once per instance
+    std::vector<VertexAttribute> platformAttributes{
+            {4, 3, GL_FLOAT, GL_FALSE, sizeof(Platform), offsetof(Platform, pos)},
+            {5, 3, GL_FLOAT, GL_FALSE, sizeof(Platform), offsetof(Platform, size)}};
+
+    // Moving platforms add their motion, the static ones leave these attributes disabled and read zeros
+    std::vector<VertexAttribute> movingAttributes{
+            {4, 3, GL_FLOAT, GL_FALSE, sizeof(MovingPlatform), offsetof(MovingPlatform, pos)},
+            {5, 3, GL_FLOAT, GL_FALSE, sizeof(MovingPlatform), offsetof(MovingPlatform, size)},
+            {6, 4, GL_FLOAT, GL_FALSE, sizeof(MovingPlatform), offsetof(MovingPlatform, sine)},
+            {7, 4, GL_FLOAT, GL_FALSE, sizeof(MovingPlatform), offsetof(MovingPlatform, cosine)}};
+
+    // One vertex array per instance buffer, so swapping the buffers needs no reconfiguration
+    for (int i = 0; i < 2; i++) {
+        worldVertexArray[i] = renderQueue.addVertexArray(vertexbuffer, worldAttributes, indexbuffer,
+                                                         GL_UNSIGNED_SHORT, instancebuffer[i], platformAttributes);
+        movingVertexArray[i] = renderQueue.addVertexArray(vertexbuffer, worldAttributes, indexbuffer,
+                                                          GL_UNSIGNED_SHORT, movingbuffer[i], movingAttributes);
+    }
+    playerVertexArray = renderQueue.addVertexArray(vertexbuffer, playerAttributes, indexbuffer, GL_UNSIGNED_SHORT);
+
+    // Only the model data is set per program, everything else is in the frame uniform buffer
+    worldProgram = renderQueue.addProgram(programID, [this] {
+        glm::mat4 M = World::getModelMatrix();
+        glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &M[0][0]);
+        glUniform3f(meshScaleID, cubeMesh.scale.x, cubeMesh.scale.y, cubeMesh.scale.z);
+        glUniform1f(motionTimeID, frameMotionTime);
+    });
+
+    playerProgram = renderQueue.addProgram(playerProgramID, [this] {
+        glUniformMatrix4fv(playerModelID, 1, GL_FALSE, &framePlayerModel[0][0]);
+    });
+}
 
-    cam.updateProjectionMatrix(width, height);
+void Game::updateAnimationLoop() {
+    size_t uniformSection = profiler.beginCpu("uniforms");
 
-    glm::mat4 M = World::getModelMatrix();
-    glm::mat4 V = cam.getViewMatrix();
-    glm::mat4 P = cam.getProjectionMatrix();
+    // Player and camera of the snapshot, the copy of the camera also gets the projection of the window
+    SimulationSnapshot const &snapshot = snapshots.front();
+    Camera frameCam = snapshot.cam;
+    frameCam.updateProjectionMatrix(width, height);
 
-    glUniformMatrix4fv(matrixID, 1, GL_FALSE, &(P * V * M)[0][0]);
-    glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &M[0][0]);
-    glUniformMatrix4fv(viewMatrixID, 1, GL_FALSE, &V[0][0]);
+    FrameData frame;
+    frame.V = frameCam.getViewMatrix(interpolation);
+    frame.P = frameCam.getProjectionMatrix();
+    frame.VP = frame.P * frame.V;
 
 //    glm::vec3 lightPos = glm::vec3(4, player.pos.y + 7, 2);
-    glm::vec3 lightPos = glm::vec3(player.pos.x + 4, player.pos.y + 8, player.pos.z + 2);
-    glUniform3f(lightID, lightPos.x, lightPos.y, lightPos.z);
-
-    // 1rst attribute buffer : vertices
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[0]);
-    glVertexAttribPointer(
-            0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
-            3,  // size
-            GL_FLOAT,           // type
-            GL_FALSE,           // normalized?
-            0,                  // stride
-            (void *) 0            // array buffer offset
-    );
-
-    // 2nd attribute buffer : colors
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[1]);
-    glVertexAttribPointer(
-            1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-            3,                                // size
-            GL_FLOAT,                         // type
-            GL_FALSE,                         // normalized?
-            0,                                // stride
-            (void *) 0                          // array buffer offset
-    );
-
-    // Draw the triangle !
-    glDrawArrays(GL_TRIANGLES, 0, world_vertices.size() * sizeof(glm::vec3)); // 3 indices starting at 0 -> 1 triangle
-
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-
-    glUseProgram(playerProgramID);
-
-    glm::mat4 Mp = player.getModelMatrix();
-
-    glUniformMatrix4fv(playerMatrixID, 1, GL_FALSE, &(P * V * Mp)[0][0]);
-    glUniformMatrix4fv(playerModelID, 1, GL_FALSE, &Mp[0][0]);
-    glUniformMatrix4fv(playerViewMatrixID, 1, GL_FALSE, &V[0][0]);
-
-    glUniform3f(playerLightID, lightPos.x, lightPos.y, lightPos.z);
-
-    // 1rst attribute buffer : vertices
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[2]);
-    glVertexAttribPointer(
-            2,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
-            3,  // size
-            GL_FLOAT,           // type
-            GL_FALSE,           // normalized?
-            0,                  // stride
-            (void *) 0            // array buffer offset
-    );
-
-    // 2nd attribute buffer : colors
-    glEnableVertexAttribArray(3);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer[3]);
-    glVertexAttribPointer(
-            3,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-            3,                                // size
-            GL_FLOAT,                         // type
-            GL_FALSE,                         // normalized?
-            0,                                // stride
-            (void *) 0                          // array buffer offset
-    );
-
-    // Draw the triangle !
-    glDrawArrays(GL_TRIANGLES, 0, player_vertices.size() * sizeof(glm::vec3)); // 3 indices starting at 0 -> 1 triangle
-
-    glDisableVertexAttribArray(2);
-    glDisableVertexAttribArray(3);
-
-    // Swap buffers
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    glm::vec3 playerPos = snapshot.player.getPosition(interpolation);
+    frame.lightPosition = glm::vec3(playerPos.x + 4, playerPos.y + 8, playerPos.z + 2);
+
+    // The packed player mesh is normalized, its scale is part of the model matrix
+    framePlayerModel = snapshot.player.getModelMatrix(interpolation) * glm::scale(glm::mat4(1.f), playerMesh.scale);
+
+    // Interpolated like the player, the snapshot has the time after the last step
+    frameMotionTime = snapshot.motionTime - (1 - interpolation) * simulationStep;
+
+    profiler.endCpu(uniformSection);
+
+    {
+        ProfileScope scope(profiler, "culling");
+        frustum.extract(frame.VP * World::getModelMatrix());
+        frustum.cullPlatforms(drawnWorld->platforms, drawnWorld->blocks, World::blockSize, maxCullingGap,
+                              visibleRanges, &JobSystem::global());
+
+        // Moving platforms are culled with the box of their whole motion
+        frustum.cullPlatforms(drawnWorld->movingBounds, drawnWorld->movingBlocks, World::blockSize, maxCullingGap,
+                              visibleMovingRanges, &JobSystem::global());
+    }
+
+    // The glowing platforms are taken from the visible ones
+    {
+        ProfileScope scope(profiler, "lights");
+        updateLights(snapshot, frame);
+        frameData.update(&frame);
+    }
+
+    // One cube per visible platform, and the player
+    for (PlatformRange const &range: visibleRanges) {
+        renderQueue.submit(DrawItem{worldProgram, worldVertexArray[frontInstancebuffer], 0,
+                                    (GLsizei) cubeMesh.indexCount, cubeMesh.firstIndex,
+                                    (GLsizei) range.count, (GLuint) range.first});
+    }
+    for (PlatformRange const &range: visibleMovingRanges) {
+        renderQueue.submit(DrawItem{worldProgram, movingVertexArray[frontInstancebuffer], 0,
+                                    (GLsizei) cubeMesh.indexCount, cubeMesh.firstIndex,
+                                    (GLsizei) range.count, (GLuint) range.first});
+    }
+    renderQueue.submit(DrawItem{playerProgram, playerVertexArray, 0, (GLsizei) playerMesh.indexCount,
+                                playerMesh.firstIndex, 0, 0});
+
+    {
+        ProfileScope scope(profiler, "draw", true);
+
+        // Clear the screen
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        clusterLights.bind(clusterLightsUnit);
+        clusterGrid.bind(clusterGridUnit);
+        clusterIndices.bind(clusterIndicesUnit);
+        renderQueue.flush();
+        frameData.fence();
+    }
+
+    // Swap buffers, offscreen frames have nothing to swap and wait for the drawing to finish instead
+    if (!window) {
+        ProfileScope scope(profiler, "finish");
+        glFinish();
+        return;
+    }
+    {
+        ProfileScope scope(profiler, "swap buffers");
+        glfwSwapBuffers(window);
+    }
+    {
+        ProfileScope scope(profiler, "poll events");
+        glfwPollEvents();
+    }
 }
 
-void Game::updateGameState() {
-    // todo global delta time
+void Game::updateLights(SimulationSnapshot const &snapshot, FrameData &frame) {
+    frameLights.clear();
+
+    // Time of the frame on the clock of the snapshots, which is simulated in offscreen runs
+    double now = snapshot.stepTime + interpolation * simulationStep;
+
+    // Landings are counted by the simulation, a new count means the player landed since the last frame
+    int totalJumps = snapshot.player.getTotalJumps();
+    if (totalJumps > lastTotalJumps) flashes.push_back(LandingFlash{snapshot.player.pos, now});
+    lastTotalJumps = totalJumps;
+    flashes.erase(std::remove_if(flashes.begin(), flashes.end(), [this, now](LandingFlash const &flash) {
+        return now - flash.start > flashDuration;
+    }), flashes.end());
+
+    // Most important first, lights further down the list are dropped from full clusters
+    frameLights.push_back(PointLight{snapshot.player.getSavedPosition() + glm::vec3(0, .15f, 0), 1.5f,
+                                     glm::vec3(.3f, 1, .5f), .08f});
+    for (LandingFlash const &flash: flashes) {
+        float fade = 1 - (float) ((now - flash.start) / flashDuration);
+        frameLights.push_back(PointLight{flash.position, .8f, glm::vec3(1, .8f, .4f), .15f * fade});
+    }
+    for (PlatformRange const &range: visibleRanges) {
+        size_t first = (range.first + glowInterval - 1) / glowInterval * glowInterval;
+        for (size_t i = first; i < range.first + range.count; i += glowInterval) {
+            Platform const &platform = drawnWorld->platforms[i];
+            if (platform.size.x <= 0) continue;
+            frameLights.push_back(PointLight{platform.pos + glm::vec3(0, .15f, 0), 1.2f,
+                                             glm::vec3(.4f, .6f, 1), .06f});
+        }
+    }
+
+    lightClusters.assign(frameLights, frame.V * World::getModelMatrix(), frame.P, Camera::nearPlane,
+                         Camera::farPlane);
+    clusterLights.update(lightClusters.lightData.data(), lightClusters.lightData.size() * sizeof(glm::vec4));
+    clusterGrid.update(lightClusters.clusters.data(), lightClusters.clusters.size() * sizeof(uint32_t));
+    clusterIndices.update(lightClusters.indices.data(), lightClusters.indices.size() * sizeof(uint16_t));
+
+    frame.clusterScale = lightClusters.getScale(width, height);
+    frame.clusterCount = glm::ivec4(LightClusters::tilesX, LightClusters::tilesY, LightClusters::slices, 0);
+}
 
+void Game::updateInput() {
     GLdouble xPos, yPos;
     glfwGetCursorPos(window, &xPos, &yPos);
+    windowInput.cursorX = (float) xPos;
+    windowInput.cursorY = (float) yPos;
 
+    // Actions of the simulation are counted here and carried out on the simulation thread
     if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-        if (canGenerate) {
-            initializeWorld();
-            initializeVertexbuffer();
-        }
+        if (canGenerate) windowInput.generatePresses++;
         canGenerate = false;
     }
     if (glfwGetKey(window, GLFW_KEY_E) == GLFW_RELEASE) {
         canGenerate = true;
     }
 
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+        if (canStartEndless) windowInput.endlessPresses++;
+        canStartEndless = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) {
+        canStartEndless = true;
+    }
+
     if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) {
         if (canChangeMouse) {
             if (mouseCaptured) {
@@ -273,89 +635,263 @@ void Game::updateGameState() {
         canChangeMouse = true;
     }
 
+    // The render thread writes its own trace, the simulation thread one of its loop
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
+        if (canWriteProfile) {
+            profiler.printSummary();
+            if (profiler.writeChromeTrace(tracePath)) printf("Frame trace written to %s\n", tracePath);
+            windowInput.profilePresses++;
+        }
+        canWriteProfile = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+        canWriteProfile = true;
+    }
 
-    cam.updateRotation(xPos, yPos);
+    if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS) {
+        if (canToggleRecording) windowInput.recordingPresses++;
+        canToggleRecording = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_RELEASE) {
+        canToggleRecording = true;
+    }
 
-    player.updatePlayer(window, cam.direction, cam.right, world, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS) {
+        if (canStartPlayback) windowInput.playbackPresses++;
+        canStartPlayback = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_RELEASE) {
+        canStartPlayback = true;
+    }
 
-    cam.updateLookingPosition(player.pos, deltaTime);
-}
+    windowInput.input = readPlayerInput();
+    inputs.back() = windowInput;
+    inputs.publish();
 
-bool Game::cleanupVertexbuffer() {
-    // Cleanup VBO
-    glDeleteBuffers(1, vertexbuffer);
-    glDeleteVertexArrays(1, &VertexArrayID);
-    return true;
+    if (!shaderWatcher.poll().empty()) {
+        reloadShaders();
+    }
 }
 
-bool Game::closeWindow() {
-    glfwTerminate();
-    return true;
+void Game::runSimulation() {
+    double loopEnd = steadySeconds();
+    float accumulator = 0;
+
+    while (simulationRunning) {
+        simulationProfiler.beginFrame();
+
+        double start = steadySeconds();
+        float loopTime = (float) (start - loopEnd);
+        loopEnd = start;
+
+        // Don't try to catch up after long stalls, the simulation just slows down instead
+        accumulator += std::min(loopTime, maxFrameTime);
+
+        {
+            ProfileScope scope(simulationProfiler, "game state");
+            updateGameState();
+        }
+
+        bool stepped = false;
+        {
+            ProfileScope scope(simulationProfiler, "simulation");
+            while (accumulator >= simulationStep) {
+                updateSimulation();
+                accumulator -= simulationStep;
+                stepped = true;
+            }
+        }
+
+        // The last step was due accumulator seconds ago, the render thread interpolates from there
+        if (stepped || worldChanged) {
+            ProfileScope scope(simulationProfiler, "publish");
+            publishSnapshot(start - accumulator);
+        }
+
+        simulationProfiler.endFrame();
+
+        // Sleep until the next step is due
+        std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<float>(simulationStep - accumulator)));
+    }
 }
 
-void Game::loadPlayer() {
-    std::vector<glm::vec3> temp_vertices;
-    std::vector<glm::vec2> temp_uvs;
-    std::vector<glm::vec3> temp_normals;
-    loadOBJ("cube.obj", temp_vertices, temp_uvs, temp_normals);
+void Game::updateGameState() {
+    // Keeps the controls of the last published input if there's no newer one
+    InputState previous = simulationInput;
+    if (inputs.update()) simulationInput = inputs.front();
+
+    if (simulationInput.generatePresses != previous.generatePresses && !isRegenerating() && !playback.isOpen()) {
+        stopRecording();
+        startRegeneration();
+    }
+
+    if (simulationInput.endlessPresses != previous.endlessPresses && !isRegenerating() && !playback.isOpen()) {
+        stopRecording();
+        world.initializeEndless();
+        worldChanged = true;
+    }
+
+    if (simulationInput.profilePresses != previous.profilePresses) {
+        simulationProfiler.printSummary();
+        if (simulationProfiler.writeChromeTrace(simulationTracePath)) {
+            printf("Simulation trace written to %s\n", simulationTracePath);
+        }
+    }
 
-    auto trans = glm::scale(glm::mat4(1.f), player.size);
-    // processing
-    assert(temp_vertices.size() == temp_normals.size());
-    for (int i = 0; i < temp_vertices.size(); i++) {
-        auto &vert = temp_vertices.at(i);
+    if (simulationInput.recordingPresses != previous.recordingPresses && !isRegenerating() && !playback.isOpen()) {
+        if (recorder.isOpen()) stopRecording();
+        else startRecording();
+    }
 
-        auto vert4 = glm::vec4(vert, 1);
-        vert4 = trans * vert4;
-        temp_vertices.at(i) = glm::vec3{vert4};
+    if (simulationInput.playbackPresses != previous.playbackPresses && !isRegenerating() && !recorder.isOpen() &&
+        !playback.isOpen()) {
+        startPlayback();
+    }
 
-//        temp_vertices.at(i)[1] += player.size.y;
+    {
+        ProfileScope scope(simulationProfiler, "regeneration");
+        updateRegeneration();
     }
+    {
+        ProfileScope scope(simulationProfiler, "streaming");
+        updateStreaming();
+    }
+}
 
-    player_vertices.insert(player_vertices.end(), temp_vertices.begin(), temp_vertices.end());
-    player_normals.insert(player_normals.end(), temp_normals.begin(), temp_normals.end());
+PlayerInput Game::readPlayerInput() const {
+    PlayerInput input;
+    input.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    input.backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    input.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    input.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    input.toggleFlying = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+    input.jump = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+    input.down = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+    input.savepoint = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    return input;
 }
 
-void Game::loadCube(float x, float y, float z, glm::mat4 trans) {
-    std::vector<glm::vec3> temp_vertices;
-    std::vector<glm::vec2> temp_uvs;
-    std::vector<glm::vec3> temp_normals;
-    loadOBJ("cube.obj", temp_vertices, temp_uvs, temp_normals);
+void Game::updateSimulation() {
+    ReplayTick tick{simulationInput.input, simulationInput.cursorX, simulationInput.cursorY, 0};
+    uint64_t expectedHash = 0;
+
+    // A replay replaces keyboard and mouse completely
+    bool playing = playback.isOpen();
+    if (playing && !playback.next(tick)) {
+        stopPlayback();
+        playing = false;
+        tick = ReplayTick{simulationInput.input, simulationInput.cursorX, simulationInput.cursorY, 0};
+    }
+    expectedHash = tick.stateHash;
+
+    cam.updateRotation(tick.cursorX, tick.cursorY);
 
-    // processing
-    assert(temp_vertices.size() == temp_normals.size());
-    for (int i = 0; i < temp_vertices.size(); i++) {
-        auto &vert = temp_vertices.at(i);
+    player.updatePlayer(tick.input, cam.direction, cam.right, world, simulationStep);
+    world.advance(simulationStep);
 
-        auto vert4 = glm::vec4(vert, 1);
-        vert4 = trans * vert4;
-        temp_vertices.at(i) = glm::vec3{vert4};
+    cam.updateLookingPosition(player.pos, simulationStep);
 
-        temp_vertices.at(i)[0] += x;
-        temp_vertices.at(i)[1] += y;
-        temp_vertices.at(i)[2] += z;
+    tick.stateHash = player.hashState();
+    if (playing) {
+        if (!replayDiverged && tick.stateHash != expectedHash) {
+            printf("Replay diverged at tick %ld\n", replayTicks);
+            replayDiverged = true;
+        }
+        replayTicks++;
     }
+    if (recorder.isOpen()) recorder.record(tick);
+}
 
-    world_vertices.insert(world_vertices.end(), temp_vertices.begin(), temp_vertices.end());
-    world_normals.insert(world_normals.end(), temp_normals.begin(), temp_normals.end());
+void Game::resetRun(uint64_t seed, uint32_t numOfPlatforms) {
+    world.initialize(seed, numOfPlatforms);
+    worldChanged = true;
+    player = Player();
+    cam = Camera();
 }
 
-void Game::loadCube(Platform plat) {
-    glm::mat4 scale = glm::scale(glm::mat4(1.f), plat.size);
-    loadCube(plat.pos.x, plat.pos.y, plat.pos.z, scale);
+void Game::startRecording() {
+    ReplayHeader header{(uint64_t) time(nullptr), 201, simulationStep};
+    resetRun(header.seed, header.numOfPlatforms);
+    if (recorder.open(replayPath, header)) printf("Recording to %s\n", replayPath);
 }
 
-void Game::initializeWorld() {
-    world_vertices.clear();
-    world_normals.clear();
+void Game::stopRecording() {
+    if (!recorder.isOpen()) return;
+    if (recorder.close()) printf("Recording saved to %s\n", replayPath);
+}
+
+void Game::startPlayback() {
+    if (!playback.open(replayPath)) return;
+    if (playback.header.simulationStep != simulationStep) {
+        printf("Replay was recorded with a different simulation step and will diverge\n");
+    }
+    resetRun(playback.header.seed, playback.header.numOfPlatforms);
+    replayTicks = 0;
+    replayDiverged = false;
+}
 
-    world.initialize();
+void Game::stopPlayback() {
+    playback.close();
+    printf("Replay of %ld ticks finished, %s\n", replayTicks,
+           replayDiverged ? "the state diverged" : "the state matched on every tick");
+}
 
-    for (Platform p: world.platforms) {
-        loadCube(p);
+bool Game::cleanupVertexbuffer() {
+    // Cleanup VBO
+    glDeleteBuffers(1, &vertexbuffer);
+    glDeleteBuffers(1, &indexbuffer);
+    glDeleteBuffers(2, instancebuffer);
+    glDeleteBuffers(2, movingbuffer);
+    if (uploadFence) glDeleteSync(uploadFence);
+    glDeleteVertexArrays(1, &VertexArrayID);
+    return true;
+}
+
+bool Game::closeWindow() {
+    glfwTerminate();
+    return true;
+}
+
+void Game::loadPlayer() {
+    // The binary mesh is generated from cube.obj at build time
+    auto mesh = loadCachedMesh("cube.mesh");
+    if (!mesh) mesh = loadCachedMesh("cube.obj");
+    if (!mesh) mesh = getUnitCubeMesh();
+
+    // Scaled to the player size, packing normalizes it again and keeps the size in playerMesh.scale
+    Mesh scaled = *mesh;
+    for (glm::vec3 &vertex: scaled.vertices) vertex *= player.size;
+
+    if (!appendPackedMesh(scaled, meshes, playerMesh)) {
+        fprintf(stderr, "Player mesh has too many vertices for 16 bit indices\n");
+        appendPackedMesh(*getUnitCubeMesh(), meshes, playerMesh);
+        playerMesh.scale *= player.size;
     }
+}
 
-    loadPlayer();
+void Game::loadCube() {
+    // Built into the binary, no need to read cube.obj
+    appendPackedMesh(*getUnitCubeMesh(), meshes, cubeMesh);
 }
 
+void Game::initializeWorld() {
+    // World generation and reading the player mesh are independent, packing needs the mesh in the cache
+    TaskGraph graph;
+    size_t generate = graph.add([this] { world.initialize(); });
+    size_t geometry = graph.add([this] { updateWorldGeometry(); });
+    graph.precede(generate, geometry);
+
+    // The cube mesh and the player do not change with the world
+    if (meshes.indices.empty()) {
+        size_t read = graph.add([] { if (!loadCachedMesh("cube.mesh")) loadCachedMesh("cube.obj"); });
+        size_t pack = graph.add([this] {
+            loadCube();
+            loadPlayer();
+        });
+        graph.precede(read, pack);
+    }
 
+    graph.run(JobSystem::global());
+    drawnWorld = worldGeometry;
+}
@@ -3,19 +3,117 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <glfw3.h>
 
+#include "common/filewatcher.hpp"
+#include "common/meshcache.hpp"
+#ifdef JUMP_OFFSCREEN
+#include "common/offscreencontext.hpp"
+#endif
+#include "common/packedmesh.hpp"
+#include "common/profiler.hpp"
+#include "common/renderqueue.hpp"
+#include "common/texturebuffer.hpp"
+#include "common/triplebuffer.hpp"
+#include "common/uniformring.hpp"
 #include "models/camera.h"
+#include "models/frustum.h"
+#include "models/light_clusters.h"
 #include "models/player.h"
+#include "models/replay.h"
 #include "models/world.h"
 
+/**
+ * Contents of the FrameData uniform block of the shaders, in std140 layout
+ */
+struct FrameData {
+    glm::mat4 V;
+    glm::mat4 P;
+    glm::mat4 VP;
+    glm::vec3 lightPosition;
+    float padding;
+    glm::vec4 clusterScale;
+    glm::ivec4 clusterCount;
+};
+
+/**
+ * Short light where the player landed
+ */
+struct LandingFlash {
+    glm::vec3 position;
+    double start;
+};
+
+/**
+ * Controls sent from the window to the simulation thread. Single key presses are counted, so none are lost
+ * when the simulation skips a published input.
+ */
+struct InputState {
+    PlayerInput input;
+    float cursorX = 0;
+    float cursorY = 0;
+    uint32_t generatePresses = 0;
+    uint32_t endlessPresses = 0;
+    uint32_t recordingPresses = 0;
+    uint32_t playbackPresses = 0;
+    uint32_t profilePresses = 0;
+};
+
+/**
+ * Platforms of a world as they are drawn, never changed once they are shared with the render thread
+ */
+struct WorldGeometry {
+    std::vector<Platform> platforms;
+    std::vector<Platform> blocks;
+    std::vector<MovingPlatform> movingPlatforms;
+    std::vector<Platform> movingBounds;
+    std::vector<Platform> movingBlocks;
+    bool endless;
+};
+
+/**
+ * State after a simulation step, published to the render thread which interpolates from it
+ */
+struct SimulationSnapshot {
+    Player player;
+    Camera cam;
+    std::shared_ptr<const WorldGeometry> world;
+
+    /**
+     * Time of the step in seconds on the steady clock
+     */
+    double stepTime = 0;
+
+    /**
+     * Motion time of the moving platforms after the step
+     */
+    float motionTime = 0;
+};
+
 class Game {
 private:
     /**
-     * Buffer containing vertices and normals for world and player
+     * Interleaved, quantized vertices and the indices of the cube and the player mesh
+     */
+    GLuint vertexbuffer;
+    GLuint indexbuffer;
+
+    /**
+     * Front and back buffer of the per-platform instance data, the back buffer receives regenerated worlds
+     */
+    GLuint instancebuffer[2];
+    int frontInstancebuffer = 0;
+
+    /**
+     * Motion of the moving platforms as per-instance data, swapped together with the instance buffers. They are
+     * only uploaded with a new world, the shader moves them with the motion time.
      */
-    GLuint vertexbuffer[4];
+    GLuint movingbuffer[2];
 
     /**
      * ID for the vertexbuffer
@@ -25,38 +123,171 @@ private:
     /**
      * IDs for shaders and matrices
      */
-    GLuint programID, playerProgramID, matrixID, modelMatrixID, viewMatrixID, lightID,
-            playerLightID, playerModelID, playerMatrixID, playerViewMatrixID;
+    GLuint programID, playerProgramID, modelMatrixID, meshScaleID, motionTimeID, playerModelID;
 
     /**
-     * Vertices and normals for the game world
+     * Directory of the linked program binaries, and the watcher of the shader files for live reloading
      */
-    std::vector<glm::vec3> world_vertices;
-    std::vector<glm::vec3> world_normals;
+    const char *shaderCacheDirectory = "shadercache";
+    FileWatcher shaderWatcher;
 
     /**
-     * Vertices and normals for the player
+     * Cube and player mesh before they are uploaded, and where each of them is in the buffers
      */
-    std::vector<glm::vec3> player_vertices;
-    std::vector<glm::vec3> player_normals;
+    PackedMesh meshes;
+    PackedMeshRange cubeMesh;
+    PackedMeshRange playerMesh;
 
     /**
-     * The window of the application
+     * The window of the application, nullptr when drawing offscreen
      */
-    GLFWwindow *window;
+    GLFWwindow *window = nullptr;
 
+#ifdef JUMP_OFFSCREEN
     /**
-     * Objects for camera, player, and world
+     * Context and framebuffer that replace the window in offscreen runs
+     */
+    OffscreenContext offscreen;
+#endif
+
+    /**
+     * Samples per pixel of the window and of the offscreen framebuffer
+     */
+    static const int samples = 4;
+
+    /**
+     * Objects for camera, player, and world, owned by the simulation thread once it runs
      */
     Camera cam;
     Player player;
     World world;
 
+    /**
+     * Copy of the world platforms that is shared with the render thread, and whether it is outdated
+     */
+    std::shared_ptr<const WorldGeometry> worldGeometry;
+    bool worldChanged = false;
+
+    /**
+     * World that is generated in the background
+     */
+    std::future<std::unique_ptr<World>> nextWorld;
+
+    /**
+     * World in the front instance buffer, and the one uploaded to the back buffer until uploadFence is signaled
+     */
+    std::shared_ptr<const WorldGeometry> drawnWorld;
+    std::shared_ptr<const WorldGeometry> uploadingWorld;
+    GLsync uploadFence = nullptr;
+
+    /**
+     * Controls read by the window once per frame, and the last ones the simulation took
+     */
+    InputState windowInput;
+    InputState simulationInput;
+
+    /**
+     * Controls from the window to the simulation thread and snapshots back, neither side waits for the other
+     */
+    TripleBuffer<InputState> inputs;
+    TripleBuffer<SimulationSnapshot> snapshots;
+
+    /**
+     * Thread that runs the simulation at a fixed rate while the main thread renders
+     */
+    std::thread simulationThread;
+    std::atomic<bool> simulationRunning{false};
+
+    /**
+     * Recording and playback of the per-step input
+     */
+    ReplayRecorder recorder;
+    ReplayPlayer playback;
+    const char *replayPath = "replay.gjr";
+
+    /**
+     * Number of steps played back and whether the player state differed from the recording
+     */
+    long replayTicks = 0;
+    bool replayDiverged = false;
+
+    /**
+     * Draws of a frame, sorted by state before they are submitted
+     */
+    RenderQueue renderQueue;
+
+    /**
+     * Render queue handles of the programs and of the vertex arrays, one world vertex array per instance buffer
+     */
+    size_t worldProgram, playerProgram;
+    size_t worldVertexArray[2], movingVertexArray[2], playerVertexArray;
+
+    /**
+     * Camera and light of the frame in a ring of uniform buffer copies, bound to every program
+     */
+    UniformRing frameData;
+    static const GLuint frameDataBinding = 0;
+
+    /**
+     * Point lights of the frame and their assignment to the clusters of the view, read by the fragment shaders
+     * from buffer textures on the texture units below
+     */
+    std::vector<PointLight> frameLights;
+    LightClusters lightClusters;
+    TextureBuffer clusterLights, clusterGrid, clusterIndices;
+    static const GLuint clusterLightsUnit = 0, clusterGridUnit = 1, clusterIndicesUnit = 2;
+
+    /**
+     * Flashes of the last landings, the landing counter of the last snapshot and how long a flash is lit
+     */
+    std::vector<LandingFlash> flashes;
+    int lastTotalJumps = 0;
+    double flashDuration = .4;
+
+    /**
+     * Every glowInterval-th platform glows, one per savepoint distance
+     */
+    size_t glowInterval = 20;
+
+    /**
+     * Model matrix of the player and motion time of the moving platforms in the frame that is drawn
+     */
+    glm::mat4 framePlayerModel;
+    float frameMotionTime = 0;
+
+    /**
+     * Frustum of the current frame and the ranges of platforms inside it
+     */
+    Frustum frustum;
+    std::vector<PlatformRange> visibleRanges;
+    std::vector<PlatformRange> visibleMovingRanges;
+
+    /**
+     * Invisible platforms between two visible ones that are still drawn to save a draw call
+     */
+    size_t maxCullingGap = 16;
+
+    /**
+     * CPU and GPU timings of the last frames, written as a Chrome trace on request
+     */
+    Profiler profiler;
+    const char *tracePath = "trace.json";
+
+    /**
+     * Timings of the simulation thread, which has a frame per loop iteration
+     */
+    Profiler simulationProfiler;
+    const char *simulationTracePath = "simulation_trace.json";
+
     /**
      * Booleans to only accept single key presses
      */
     bool canGenerate = true;
+    bool canStartEndless = true;
     bool canChangeMouse = true;
+    bool canToggleRecording = true;
+    bool canStartPlayback = true;
+    bool canWriteProfile = true;
 
     /**
      * True if the mouse is captured by the window
@@ -68,6 +299,48 @@ private:
      */
     void updateAnimationLoop();
 
+    /**
+     * Collect the lights of the frame, assign them to clusters and upload them
+     *
+     * @param snapshot snapshot that is drawn
+     * @param frame frame data that receives the cluster parameters
+     */
+    void updateLights(SimulationSnapshot const &snapshot, FrameData &frame);
+
+    /**
+     * Simulation loop of the simulation thread, runs until simulationRunning is cleared
+     */
+    void runSimulation();
+
+    /**
+     * Publish the current player, camera and world for the render thread
+     *
+     * @param stepTime time of the last simulation step on the steady clock
+     */
+    void publishSnapshot(double stepTime);
+
+    /**
+     * Take the newest snapshot and upload its world if it changed
+     */
+    void updateSnapshot();
+
+    /**
+     * Upload the platforms of a world that differs from the drawn one
+     *
+     * @param geometry platforms of the new world
+     */
+    void uploadWorld(std::shared_ptr<const WorldGeometry> const &geometry);
+
+    /**
+     * Update the copy of the world platforms that is shared with the render thread
+     */
+    void updateWorldGeometry();
+
+    /**
+     * Read the keyboard and cursor and publish them for the simulation thread
+     */
+    void updateInput();
+
     /**
      * Clean up vertex buffer
      *
@@ -83,31 +356,51 @@ private:
     static bool closeWindow();
 
     /**
-     * Load a cube to x y and z coordinates and apply a transformation matrix
-     *
-     * @param x x coordinate
-     * @param y y coordinate
-     * @param z z coordinate
-     * @param trans transformation matrix
+     * Load the unit cube that is instanced for every platform
+     */
+    void loadCube();
+
+    /**
+     * Load the player cube
+     */
+    void loadPlayer();
+
+    /**
+     * Update the inner game state once per simulation loop, with the controls of the window
      */
-    void loadCube(float x, float y, float z, glm::mat4 trans);
+    void updateGameState();
+
+    /**
+     * Advance player and camera by one simulation step
+     */
+    void updateSimulation();
 
     /**
-     * Load a cube according to a platform object
+     * Start over with a new fixed world and a fresh player and camera
      *
-     * @param plat platform object
+     * @param seed seed of the world
+     * @param numOfPlatforms number of platforms of the world
      */
-    void loadCube(Platform plat);
+    void resetRun(uint64_t seed, uint32_t numOfPlatforms);
 
     /**
-     * Load the player cube
+     * Start and stop recording the input of every simulation step
      */
-    void loadPlayer();
+    void startRecording();
+    void stopRecording();
 
     /**
-     * Update the inner game state
+     * Start and stop playing back a recording instead of the keyboard and mouse input
      */
-    void updateGameState();
+    void startPlayback();
+    void stopPlayback();
+
+    /**
+     * Read the player controls from the keyboard
+     *
+     * @return current state of the controls
+     */
+    PlayerInput readPlayerInput() const;
 
     /**
      * Initialize the game world
@@ -121,6 +414,18 @@ private:
      */
     bool initializeWindow();
 
+    /**
+     * Initialize world, buffers, shaders and render queue once a context is current
+     *
+     * @return true if successful
+     */
+    bool initializeRendering();
+
+    /**
+     * Delete the GL objects of the game, the context stays
+     */
+    void cleanup();
+
     /**
      * Initialize the vertex buffer
      *
@@ -128,11 +433,58 @@ private:
      */
     bool initializeVertexbuffer();
 
+    /**
+     * Upload the platforms of the drawn world as per-instance data
+     */
+    void updateInstancebuffer();
+
+    /**
+     * Stream chunks of the endless world
+     */
+    void updateStreaming();
+
+    /**
+     * Start generating a new world in the background
+     */
+    void startRegeneration();
+
+    /**
+     * Take over a finished background world
+     */
+    void updateRegeneration();
+
+    /**
+     * Swap in the back instance buffer once its upload is done
+     */
+    void updateUpload();
+
+    /**
+     * True while a background world is generated
+     *
+     * @return true if a regeneration is in progress
+     */
+    bool isRegenerating() const;
+
     /**
      * Initialize the OpenGL IDs
      */
     void initializeIDs();
 
+    /**
+     * Look up the uniforms of the programs and bind them to the frame uniform buffer
+     */
+    void initializeUniforms();
+
+    /**
+     * Compile the shaders again after a shader file changed, the running programs are kept if that fails
+     */
+    void reloadShaders();
+
+    /**
+     * Configure the vertex arrays and programs of the render queue
+     */
+    void initializeRenderQueue();
+
 public:
     /**
      * Run the game
@@ -146,11 +498,60 @@ public:
      */
     bool initialize();
 
+#ifdef JUMP_OFFSCREEN
+    /**
+     * Initialize the game without window, drawing into a framebuffer of an EGL context
+     *
+     * @param frameWidth width of the frames in pixels
+     * @param frameHeight height of the frames in pixels
+     * @return true if successful
+     */
+    bool initializeOffscreen(int frameWidth, int frameHeight);
+
+    /**
+     * Draw a number of frames as fast as possible and print the frame time percentiles and a checksum of the
+     * last frame. The simulation runs on the render thread with a fixed number of steps per frame, so every
+     * run draws the same frames.
+     *
+     * @param frames number of frames
+     * @param replayFile recording that is played back, nullptr to circle the camera around the player
+     * @param imagePath path the last frame is written to as PPM, nullptr for none
+     * @return 0 if successful
+     */
+    int runOffscreen(size_t frames, const char *replayFile, const char *imagePath);
+
+    /**
+     * World of offscreen runs without replay
+     */
+    uint64_t offscreenSeed = 1;
+    uint32_t offscreenPlatforms = 201;
+
+    /**
+     * Simulation steps per offscreen frame, 60 frames per simulated second
+     */
+    int offscreenStepsPerFrame = 4;
+#endif
+
     /**
      * Overall delta time of the last game loop iteration
      */
     float deltaTime = 0;
 
+    /**
+     * Duration of one simulation step, the simulation runs at a fixed rate independent of the frame rate
+     */
+    float simulationStep = 1.f / 240.f;
+
+    /**
+     * Longest frame time that is simulated, longer frames slow the game down
+     */
+    float maxFrameTime = .25f;
+
+    /**
+     * Position of the rendered frame between the last two simulation steps, from 0 to 1
+     */
+    float interpolation = 0;
+
     /**
      * Width and height of window
      */
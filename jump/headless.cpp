@@ -0,0 +1,142 @@
+// Runs the game simulation without window, input devices or OpenGL. A bot plays a number of worlds
+// and the reached heights are reported, for balancing and regression tests on machines without a GPU.
+//
+// Usage : jump_headless [runs] [seconds per run] [platforms per world] [step in seconds]
+//         jump_headless --record <file> [seconds] [platforms]   records one bot run
+//         jump_headless --replay <file>                        plays a recording back and checks every step
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "models/bot.h"
+#include "models/camera.h"
+#include "models/player.h"
+#include "models/replay.h"
+#include "models/world.h"
+
+// Same step as the game loop
+static const float simulationStep = 1.f / 240.f;
+
+// The bot only presses the keys here, the camera turns with a synthetic cursor path. The player walks
+// relative to the camera like in the game, so the bot plays worse, but the recording covers the mouse too.
+static int record(const char *path, float seconds, size_t numOfPlatforms) {
+    ReplayHeader header{(uint64_t) time(nullptr), (uint32_t) numOfPlatforms, simulationStep};
+    ReplayRecorder recorder;
+    if (!recorder.open(path, header)) return 1;
+
+    World world;
+    world.initialize(header.seed, header.numOfPlatforms);
+    Player player;
+    Camera cam;
+    Bot bot;
+
+    const long steps = (long) (seconds / simulationStep);
+    for (long step = 0; step < steps; step++) {
+        ReplayTick tick{bot.update(player, world), (float) (step % 2000), 300.f, 0};
+        cam.updateRotation(tick.cursorX, tick.cursorY);
+        player.updatePlayer(tick.input, cam.direction, cam.right, world, simulationStep);
+        world.advance(simulationStep);
+        cam.updateLookingPosition(player.pos, simulationStep);
+        tick.stateHash = player.hashState();
+        recorder.record(tick);
+        if (!recorder.isOpen()) return 1;
+    }
+    if (!recorder.close()) return 1;
+
+    printf("recorded %ld steps to %s, highest point %.2f\n", steps, path, player.pos.y);
+    return 0;
+}
+
+// Applies the recorded input exactly as Game::updateSimulation does
+static int replay(const char *path) {
+    ReplayPlayer playback;
+    if (!playback.open(path)) return 1;
+
+    World world;
+    world.initialize(playback.header.seed, playback.header.numOfPlatforms);
+    Player player;
+    Camera cam;
+
+    long ticks = 0, divergedAt = -1;
+    ReplayTick tick;
+    auto start = std::chrono::steady_clock::now();
+    while (playback.next(tick)) {
+        cam.updateRotation(tick.cursorX, tick.cursorY);
+        player.updatePlayer(tick.input, cam.direction, cam.right, world, playback.header.simulationStep);
+        world.advance(playback.header.simulationStep);
+        cam.updateLookingPosition(player.pos, playback.header.simulationStep);
+        if (divergedAt < 0 && player.hashState() != tick.stateHash) divergedAt = ticks;
+        ticks++;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%ld steps in %.3f s : %.0f steps/s\n", ticks, elapsed, ticks / elapsed);
+    if (divergedAt >= 0) {
+        printf("state diverged at step %ld\n", divergedAt);
+        return 1;
+    }
+    printf("state matched on every step\n");
+    return 0;
+}
+
+static int usage(const char *program) {
+    fprintf(stderr, "Usage : %s [runs] [seconds per run] [platforms per world] [step in seconds]\n"
+                    "        %s --record <file> [seconds] [platforms]\n"
+                    "        %s --replay <file>\n", program, program, program);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--record") == 0) {
+        return record(argv[2], argc > 3 ? (float) atof(argv[3]) : 60.f,
+                      argc > 4 ? strtoul(argv[4], nullptr, 10) : 201);
+    }
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+        return replay(argv[2]);
+    }
+
+    int runs = argc > 1 ? atoi(argv[1]) : 100;
+    float seconds = argc > 2 ? (float) atof(argv[2]) : 60.f;
+    size_t numOfPlatforms = argc > 3 ? strtoul(argv[3], nullptr, 10) : 201;
+
+    // Collision is swept, so batch runs may take much larger steps than the game loop
+    float step = argc > 4 ? (float) atof(argv[4]) : simulationStep;
+    if (runs < 1 || !(step > 0)) return usage(argv[0]);
+    const long steps = (long) (seconds / step);
+
+    float sumHeight = 0, minHeight = 1e30f, maxHeight = 0;
+    long sumJumps = 0;
+    World world;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++) {
+        // Every run has its own world, but the same run always plays the same one
+        world.initialize((uint64_t) run, numOfPlatforms);
+        Player player;
+        Bot bot;
+
+        float highest = 0;
+        for (long i = 0; i < steps; i++) {
+            PlayerInput input = bot.update(player, world);
+            player.updatePlayer(input, bot.direction, bot.right, world, step);
+            world.advance(step);
+            highest = std::max(highest, player.pos.y);
+        }
+
+        sumHeight += highest;
+        minHeight = std::min(minHeight, highest);
+        maxHeight = std::max(maxHeight, highest);
+        sumJumps += player.getTotalJumps();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%d runs of %.0f s in %.3f s : %.1f runs/s, %.0f steps/s\n", runs, seconds, elapsed, runs / elapsed,
+           runs * (double) steps / elapsed);
+    printf("highest point : mean %.2f, min %.2f, max %.2f\n", sumHeight / runs, minHeight, maxHeight);
+    printf("jumps per run : %.1f\n", (double) sumJumps / runs);
+    return 0;
+}
@@ -1,12 +1,35 @@
+// Usage : jump
+//         jump --offscreen [frames] [width] [height] [replay file or -] [image file]
+//             draws without window and prints frame time percentiles and a checksum of the last frame
+
+#include <cstdlib>
+#include <cstring>
+
 #include "game.h"
 
-int main() {
+int main(int argc, char **argv) {
     Game game{};
 
+#ifdef JUMP_OFFSCREEN
+    if (argc > 1 && strcmp(argv[1], "--offscreen") == 0) {
+        size_t frames = argc > 2 ? strtoul(argv[2], nullptr, 10) : 600;
+        int frameWidth = argc > 3 ? atoi(argv[3]) : Game::width;
+        int frameHeight = argc > 4 ? atoi(argv[4]) : Game::height;
+        const char *replayFile = argc > 5 && strcmp(argv[5], "-") != 0 ? argv[5] : nullptr;
+        const char *imagePath = argc > 6 ? argv[6] : nullptr;
+
+        if (!game.initializeOffscreen(frameWidth, frameHeight)) return -1;
+        return game.runOffscreen(frames, replayFile, imagePath);
+    }
+#else
+    (void) argc;
+    (void) argv;
+#endif
+
     //Initialize game
     if (!game.initialize()) return -1;
 
     game.run();
 
     return 0;
-}
\ No newline at end of file
+}
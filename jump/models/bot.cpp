@@ -0,0 +1,29 @@
+#include "bot.h"
+
+PlayerInput Bot::update(Player const &player, World const &world) {
+    PlayerInput input;
+    if (world.platforms.empty()) return input;
+
+    // After every landing head for the next platform, platforms are stored in the order of the chain
+    if (player.getTotalJumps() != lastJumps) {
+        lastJumps = player.getTotalJumps();
+
+        // The player bounces off for the rest of the step it landed in, with long steps that is far above the platform
+        PlatformHit below;
+        glm::vec3 bottom = player.pos - glm::vec3(0, player.size.y, 0);
+        if (world.grid.castDown(bottom + glm::vec3(0, .01f, 0), glm::vec2(player.size.x, player.size.z), 1.f, below)) {
+            target = (below.index + 1) % world.platforms.size();
+        }
+    }
+
+    Platform const &goal = world.platforms[target % world.platforms.size()];
+    glm::vec3 toGoal = (goal.pos - player.pos) * glm::vec3(1, 0, 1);
+
+    // Stop close to the center so the player does not overshoot small platforms
+    if (glm::length(toGoal) > .05f) {
+        direction = glm::normalize(toGoal);
+        right = glm::normalize(glm::cross(direction, glm::vec3(0, 1, 0)));
+        input.forward = true;
+    }
+    return input;
+}
@@ -0,0 +1,43 @@
+#ifndef OPENGL_TEMPLATE_BOT_H
+#define OPENGL_TEMPLATE_BOT_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "input.h"
+#include "player.h"
+#include "world.h"
+
+/**
+ * Simple automatic player that climbs the chain by steering to the platform after the one it stands on
+ */
+class Bot {
+    /**
+     * Index of the platform the bot is heading for
+     */
+    size_t target = 1;
+
+    /**
+     * Number of landings of the player at the last update
+     */
+    int lastJumps = 0;
+
+public:
+    /**
+     * Forward and right direction the bot is looking at
+     */
+    glm::vec3 direction = glm::vec3(0, 0, -1);
+    glm::vec3 right = glm::vec3(1, 0, 0);
+
+    /**
+     * Decide the controls for the next simulation step
+     *
+     * @param player player controlled by the bot
+     * @param world game world object
+     * @return controls for the player
+     */
+    PlayerInput update(Player const &player, World const &world);
+};
+
+
+#endif //OPENGL_TEMPLATE_BOT_H
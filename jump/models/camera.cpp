@@ -6,12 +6,15 @@
 
 #include <cmath>
 
+constexpr float Camera::nearPlane;
+constexpr float Camera::farPlane;
+
 void Camera::updateRotation(float x, float y) {
+    // The first position only sets the reference, the direction is still computed
     if (firstMouseMovement) {
         lastX = x;
         lastY = y;
         firstMouseMovement = false;
-        return;
     }
 
     horizontalAngle += mouseSpeed * float(lastX - x);
@@ -36,21 +39,27 @@ void Camera::updateRotation(float x, float y) {
 }
 
 void Camera::updateLookingPosition(glm::vec3 pos, float deltaTime) {
+    if (deltaTime != smoothingDelta) {
+        smoothingDelta = deltaTime;
+        smoothing = glm::vec3(1 - pow(power.x, deltaTime), 1 - pow(power.y, deltaTime), 1 - pow(power.z, deltaTime));
+    }
+
+    previousLookAtPosition = lookAtPosition;
     targetPosition = pos;
-    lookAtPosition = lookAtPosition + (targetPosition - lookAtPosition) *
-                                      glm::vec3(1 - pow(power.x, deltaTime), 1 - pow(power.y, deltaTime),
-                                                1 - pow(power.z, deltaTime));
+    lookAtPosition = lookAtPosition + (targetPosition - lookAtPosition) * smoothing;
 }
 
 glm::mat4 Camera::getProjectionMatrix() {
     return P;
 }
 
-glm::mat4 Camera::getViewMatrix() {
+glm::mat4 Camera::getViewMatrix(float interpolation) {
+    glm::vec3 center = glm::mix(previousLookAtPosition, lookAtPosition, interpolation);
+
     // Camera matrix
     V = glm::lookAt(
-            lookAtPosition - 1.5f * direction, // Camera is at (4,3,3), in World Space
-            lookAtPosition, // and looks at the origin
+            center - 1.5f * direction, // Camera is at (4,3,3), in World Space
+            center, // and looks at the origin
             glm::vec3(0, 1, 0)  // Head is up (set to 0,-1,0 to look upside-down)
     );
 
@@ -58,5 +67,5 @@ glm::mat4 Camera::getViewMatrix() {
 }
 
 void Camera::updateProjectionMatrix(int width, int height) {
-    P = glm::perspective(glm::radians(70.0f), (float) width / height, 0.1f, 100.0f);
+    P = glm::perspective(glm::radians(70.0f), (float) width / height, nearPlane, farPlane);
 }
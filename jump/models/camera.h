@@ -3,7 +3,6 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glfw3.h>
 
 class Camera {
     /**
@@ -12,11 +11,22 @@ class Camera {
     glm::vec3 lookAtPosition;
     glm::vec3 targetPosition;
 
+    /**
+     * Look at position before the last update, for interpolation when rendering
+     */
+    glm::vec3 previousLookAtPosition;
+
     /**
      * Power for interpolation of look at direction
      */
     glm::vec3 power = glm::vec3(0.0002, 0.02, 0.0002);
 
+    /**
+     * Interpolation factors for the last step length, pow() is only evaluated again if the step length changes
+     */
+    float smoothingDelta = -1;
+    glm::vec3 smoothing;
+
     /**
      * Mouse speed
      */
@@ -50,10 +60,16 @@ class Camera {
     glm::mat4 P;
 
 public:
+    /**
+     * Distance of the near and the far plane of the projection
+     */
+    static constexpr float nearPlane = 0.1f;
+    static constexpr float farPlane = 100.0f;
+
     /**
      * Constructor
      */
-    Camera() : P(glm::perspective(glm::radians(70.0f), 16.f / 9.f, 0.1f, 100.0f)) {};
+    Camera() : P(glm::perspective(glm::radians(70.0f), 16.f / 9.f, nearPlane, farPlane)) {};
 
     /**
      * Update rotation of the camera
@@ -82,9 +98,10 @@ public:
     /**
      * Get view matrix from camera
      *
+     * @param interpolation 0 for the look at position before the last update, 1 for the current one
      * @return view matrix
      */
-    glm::mat4 getViewMatrix();
+    glm::mat4 getViewMatrix(float interpolation = 1);
 
     /**
      * Get projection matrix from camera
@@ -0,0 +1,159 @@
+#include "frustum.h"
+
+#include <algorithm>
+
+#include "common/jobsystem.hpp"
+#include "world.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+/**
+ * Worlds with fewer blocks are culled on the calling thread even if a job system is given
+ */
+static const size_t parallelBlocks = 1024;
+
+void Frustum::extract(glm::mat4 const &viewProjection) {
+    // Rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    // Clip space is -w to w on every axis, the planes don't need to be normalized for a sign test
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+}
+
+bool Frustum::intersects(glm::vec3 center, glm::vec3 halfSize) const {
+    for (glm::vec4 const &plane: planes) {
+        glm::vec3 normal(plane);
+
+        // The box is outside if even its corner furthest along the normal is behind the plane
+        float distance = glm::dot(normal, center) + plane.w;
+        float radius = glm::dot(glm::abs(normal), halfSize);
+        if (distance + radius < 0) return false;
+    }
+    return true;
+}
+
+static void addVisible(size_t index, size_t maxGap, std::vector<PlatformRange> &ranges) {
+    if (!ranges.empty() && index - (ranges.back().first + ranges.back().count) <= maxGap) {
+        ranges.back().count = index - ranges.back().first + 1;
+    } else {
+        ranges.push_back(PlatformRange{index, 1});
+    }
+}
+
+// Calls visit(first + i) for every box that may be visible, four boxes at a time with SSE where available
+template<typename Visit>
+static void testBoxes(glm::vec4 const planes[6], Platform const *boxes, size_t count, size_t first, Visit visit) {
+    size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+    __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    for (int k = 0; k < 6; k++) {
+        nx[k] = _mm_set1_ps(planes[k].x);
+        ny[k] = _mm_set1_ps(planes[k].y);
+        nz[k] = _mm_set1_ps(planes[k].z);
+        nw[k] = _mm_set1_ps(planes[k].w);
+        ax[k] = _mm_andnot_ps(signMask, nx[k]);
+        ay[k] = _mm_andnot_ps(signMask, ny[k]);
+        az[k] = _mm_andnot_ps(signMask, nz[k]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        Platform const *p = boxes + i;
+        __m128 cx = _mm_setr_ps(p[0].pos.x, p[1].pos.x, p[2].pos.x, p[3].pos.x);
+        __m128 cy = _mm_setr_ps(p[0].pos.y, p[1].pos.y, p[2].pos.y, p[3].pos.y);
+        __m128 cz = _mm_setr_ps(p[0].pos.z, p[1].pos.z, p[2].pos.z, p[3].pos.z);
+        __m128 ex = _mm_setr_ps(p[0].size.x, p[1].size.x, p[2].size.x, p[3].size.x);
+        __m128 ey = _mm_setr_ps(p[0].size.y, p[1].size.y, p[2].size.y, p[3].size.y);
+        __m128 ez = _mm_setr_ps(p[0].size.z, p[1].size.z, p[2].size.z, p[3].size.z);
+
+        // Empty slots of the endless world have no size
+        __m128 inside = _mm_cmpgt_ps(ex, zero);
+        for (int k = 0; k < 6 && _mm_movemask_ps(inside); k++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[k], cx), _mm_mul_ps(ny[k], cy)),
+                                         _mm_add_ps(_mm_mul_ps(nz[k], cz), nw[k]));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[k], ex), _mm_mul_ps(ay[k], ey)),
+                                       _mm_mul_ps(az[k], ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) visit(first + i + lane);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        Platform const &p = boxes[i];
+        if (p.size.x <= 0) continue;
+
+        bool inside = true;
+        for (int k = 0; k < 6 && inside; k++) {
+            glm::vec3 normal(planes[k]);
+            inside = glm::dot(normal, p.pos) + planes[k].w + glm::dot(glm::abs(normal), p.size) >= 0;
+        }
+        if (inside) visit(first + i);
+    }
+}
+
+size_t Frustum::cullPlatforms(std::vector<Platform> const &platforms, std::vector<Platform> const &blocks,
+                              size_t blockSize, size_t maxGap, std::vector<PlatformRange> &ranges,
+                              JobSystem *jobs) const {
+    // Whole blocks are rejected first, only the platforms of visible blocks are tested one by one
+    auto cullBlocks = [&](size_t firstBlock, size_t endBlock, std::vector<PlatformRange> &out) {
+        size_t visible = 0;
+        testBoxes(planes, blocks.data() + firstBlock, endBlock - firstBlock, firstBlock, [&](size_t block) {
+            size_t first = block * blockSize;
+            size_t count = std::min(blockSize, platforms.size() - first);
+            testBoxes(planes, platforms.data() + first, count, first, [&](size_t index) {
+                addVisible(index, maxGap, out);
+                visible++;
+            });
+        });
+        return visible;
+    };
+
+    ranges.clear();
+    if (jobs == nullptr || blocks.size() < parallelBlocks) return cullBlocks(0, blocks.size(), ranges);
+
+    // Every piece of the world collects its own ranges, they are joined in order afterwards
+    size_t pieces = 4 * jobs->getThreadCount();
+    size_t blocksPerPiece = (blocks.size() + pieces - 1) / pieces;
+    std::vector<std::vector<PlatformRange>> pieceRanges(pieces);
+    std::vector<size_t> pieceVisible(pieces, 0);
+    jobs->parallelFor(pieces, 1, [&](size_t firstPiece, size_t endPiece) {
+        for (size_t piece = firstPiece; piece < endPiece; piece++) {
+            size_t firstBlock = std::min(blocks.size(), piece * blocksPerPiece);
+            size_t endBlock = std::min(blocks.size(), firstBlock + blocksPerPiece);
+            pieceVisible[piece] = cullBlocks(firstBlock, endBlock, pieceRanges[piece]);
+        }
+    });
+
+    size_t visible = 0;
+    for (size_t piece = 0; piece < pieces; piece++) {
+        visible += pieceVisible[piece];
+        for (PlatformRange const &range: pieceRanges[piece]) {
+            // Ranges on both sides of a piece border are merged like any other
+            PlatformRange *last = ranges.empty() ? nullptr : &ranges.back();
+            if (last && range.first - (last->first + last->count) <= maxGap) {
+                last->count = range.first + range.count - last->first;
+            } else {
+                ranges.push_back(range);
+            }
+        }
+    }
+    return visible;
+}
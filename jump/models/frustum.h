@@ -0,0 +1,63 @@
+#ifndef OPENGL_TEMPLATE_FRUSTUM_H
+#define OPENGL_TEMPLATE_FRUSTUM_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Platform;
+class JobSystem;
+
+/**
+ * Range of consecutive platforms that is drawn with a single instanced draw call
+ */
+struct PlatformRange {
+    size_t first;
+    size_t count;
+};
+
+/**
+ * View frustum as six planes, for culling platforms before they are drawn
+ */
+class Frustum {
+    /**
+     * Left, right, bottom, top, near and far plane, a point p is inside if dot(plane.xyz, p) + plane.w >= 0
+     */
+    glm::vec4 planes[6];
+
+public:
+    /**
+     * Extract the planes from a combined projection and view matrix
+     *
+     * @param viewProjection projection matrix times view matrix
+     */
+    void extract(glm::mat4 const &viewProjection);
+
+    /**
+     * Test an axis aligned box against the frustum, boxes near a corner may be reported as visible
+     *
+     * @param center center of the box
+     * @param halfSize half size of the box
+     * @return true if the box may be visible
+     */
+    bool intersects(glm::vec3 center, glm::vec3 halfSize) const;
+
+    /**
+     * Collect the visible platforms as ranges of consecutive platforms. Blocks are tested before their
+     * platforms, both four at a time with SSE where available.
+     *
+     * @param platforms platforms to test, their instance data is in the same order
+     * @param blocks bounding box of every block of blockSize consecutive platforms, as center and half size
+     * @param blockSize number of platforms per block
+     * @param maxGap invisible platforms between two visible ones up to which the ranges are merged
+     * @param ranges visible ranges in ascending order
+     * @param jobs job system that culls large worlds in parallel, nullptr to cull on the calling thread
+     * @return number of visible platforms
+     */
+    size_t cullPlatforms(std::vector<Platform> const &platforms, std::vector<Platform> const &blocks,
+                         size_t blockSize, size_t maxGap, std::vector<PlatformRange> &ranges,
+                         JobSystem *jobs = nullptr) const;
+};
+
+
+#endif //OPENGL_TEMPLATE_FRUSTUM_H
@@ -0,0 +1,38 @@
+#ifndef OPENGL_TEMPLATE_INPUT_H
+#define OPENGL_TEMPLATE_INPUT_H
+
+/**
+ * State of all controls that steer the player, filled by the window, a script or a bot
+ */
+struct PlayerInput {
+    /**
+     * Movement forward, backward, left and right (W, S, A, D)
+     */
+    bool forward = false;
+    bool backward = false;
+    bool left = false;
+    bool right = false;
+
+    /**
+     * Toggle the flying mode (Q)
+     */
+    bool toggleFlying = false;
+
+    /**
+     * Reset to the start, or move up while flying (Space)
+     */
+    bool jump = false;
+
+    /**
+     * Move down while flying (LShift)
+     */
+    bool down = false;
+
+    /**
+     * Return to the last savepoint (F)
+     */
+    bool savepoint = false;
+};
+
+
+#endif //OPENGL_TEMPLATE_INPUT_H
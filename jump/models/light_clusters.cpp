@@ -0,0 +1,98 @@
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int LightClusters::tilesX;
+const int LightClusters::tilesY;
+const int LightClusters::slices;
+const int LightClusters::clusterCount;
+const size_t LightClusters::maxLights;
+const uint32_t LightClusters::maxLightsPerCluster;
+
+glm::vec4 LightClusters::getScale(int width, int height) const {
+    return glm::vec4((float) tilesX / width, (float) tilesY / height, sliceScale, sliceBias);
+}
+
+void LightClusters::assign(std::vector<PointLight> const &lights, glm::mat4 const &view,
+                           glm::mat4 const &projection, float near, float far) {
+    // Slices get thicker with the distance like the depth resolution, slice 0 starts at near and the last ends at far
+    sliceScale = slices / std::log(far / near);
+    sliceBias = -std::log(near) * sliceScale;
+
+    // A perspective projection maps a point in view space to ndc = (P00 x + P20 z, P11 y + P21 z) / -z
+    float scaleX = projection[0][0], shiftX = projection[2][0];
+    float scaleY = projection[1][1], shiftY = projection[2][1];
+
+    size_t count = std::min(lights.size(), maxLights);
+    lightData.resize(2 * count);
+    ranges.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        PointLight const &light = lights[i];
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1));
+        float radius = light.radius;
+        lightData[2 * i] = glm::vec4(center, radius);
+        lightData[2 * i + 1] = glm::vec4(light.color, light.power);
+
+        ClusterRange &range = ranges[i];
+        range.from = glm::ivec3(1);
+        range.to = glm::ivec3(0);
+
+        // The camera looks down -z
+        float closest = std::max(near, -center.z - radius);
+        float furthest = std::min(far, -center.z + radius);
+        if (closest > furthest) continue;
+
+        // Screen rectangle of the box around the sphere, cut off at the near plane. The corners of the cut box
+        // bound its projection, so the rectangle is conservative.
+        glm::vec2 lower(1e30f), upper(-1e30f);
+        for (int corner = 0; corner < 8; corner++) {
+            float x = center.x + (corner & 1 ? radius : -radius);
+            float y = center.y + (corner & 2 ? radius : -radius);
+            float depth = (corner & 4) ? closest : furthest;
+            glm::vec2 ndc((scaleX * x - shiftX * depth) / depth, (scaleY * y - shiftY * depth) / depth);
+            lower = glm::min(lower, ndc);
+            upper = glm::max(upper, ndc);
+        }
+        if (lower.x > 1 || lower.y > 1 || upper.x < -1 || upper.y < -1) continue;
+
+        glm::vec2 tiles((float) tilesX, (float) tilesY);
+        glm::ivec2 fromTile = glm::ivec2(glm::floor((glm::max(lower, glm::vec2(-1)) * .5f + .5f) * tiles));
+        glm::ivec2 toTile = glm::ivec2(glm::floor((glm::min(upper, glm::vec2(1)) * .5f + .5f) * tiles));
+        range.from = glm::ivec3(fromTile, (int) std::floor(std::log(closest) * sliceScale + sliceBias));
+        range.to = glm::ivec3(toTile, (int) std::floor(std::log(furthest) * sliceScale + sliceBias));
+        range.from = glm::clamp(range.from, glm::ivec3(0), glm::ivec3(tilesX - 1, tilesY - 1, slices - 1));
+        range.to = glm::clamp(range.to, glm::ivec3(0), glm::ivec3(tilesX - 1, tilesY - 1, slices - 1));
+    }
+
+    // Count the lights of every cluster, turn the counts into offsets, then fill in the same order
+    clusters.assign(2 * clusterCount, 0);
+    for (ClusterRange const &range: ranges) {
+        for (int z = range.from.z; z <= range.to.z; z++)
+            for (int y = range.from.y; y <= range.to.y; y++)
+                for (int x = range.from.x; x <= range.to.x; x++) {
+                    uint32_t &lightCount = clusters[2 * ((z * tilesY + y) * tilesX + x) + 1];
+                    if (lightCount < maxLightsPerCluster) lightCount++;
+                }
+    }
+
+    uint32_t offset = 0;
+    for (int cluster = 0; cluster < clusterCount; cluster++) {
+        clusters[2 * cluster] = offset;
+        offset += clusters[2 * cluster + 1];
+        clusters[2 * cluster + 1] = 0;
+    }
+
+    indices.resize(offset);
+    for (size_t i = 0; i < ranges.size(); i++) {
+        ClusterRange const &range = ranges[i];
+        for (int z = range.from.z; z <= range.to.z; z++)
+            for (int y = range.from.y; y <= range.to.y; y++)
+                for (int x = range.from.x; x <= range.to.x; x++) {
+                    uint32_t *cluster = &clusters[2 * ((z * tilesY + y) * tilesX + x)];
+                    if (cluster[1] == maxLightsPerCluster) continue;
+                    indices[cluster[0] + cluster[1]++] = (uint16_t) i;
+                }
+    }
+}
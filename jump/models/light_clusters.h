@@ -0,0 +1,99 @@
+#ifndef OPENGL_TEMPLATE_LIGHT_CLUSTERS_H
+#define OPENGL_TEMPLATE_LIGHT_CLUSTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * Point light whose influence ends at its radius
+ */
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float power;
+};
+
+/**
+ * Assignment of point lights to the clusters of the view frustum for clustered forward shading. The frustum is
+ * split into tilesX x tilesY screen tiles and slices depth slices of exponentially growing thickness, every
+ * fragment shades only the lights of its cluster.
+ */
+class LightClusters {
+    /**
+     * Clusters covered by a light, inclusive
+     */
+    struct ClusterRange {
+        glm::ivec3 from;
+        glm::ivec3 to;
+    };
+
+    /**
+     * Clusters of every light of the last assignment, from.x > to.x for lights outside the frustum
+     */
+    std::vector<ClusterRange> ranges;
+
+    /**
+     * Depth slice of a distance in front of the camera is log(distance) * sliceScale + sliceBias
+     */
+    float sliceScale = 0;
+    float sliceBias = 0;
+
+public:
+    /**
+     * Number of clusters in every direction
+     */
+    static const int tilesX = 16;
+    static const int tilesY = 9;
+    static const int slices = 24;
+    static const int clusterCount = tilesX * tilesY * slices;
+
+    /**
+     * Lights beyond this are ignored, and lights per cluster beyond this are dropped. Lights earlier in the list
+     * win, so the cost per fragment stays bounded however many lights there are.
+     */
+    static const size_t maxLights = 1024;
+    static const uint32_t maxLightsPerCluster = 32;
+
+    /**
+     * Two texels per light for the shaders: view space position and radius, then color and power
+     */
+    std::vector<glm::vec4> lightData;
+
+    /**
+     * Offset into indices and number of lights of every cluster, x fastest, then y, then the slice
+     */
+    std::vector<uint32_t> clusters;
+
+    /**
+     * Light indices of all clusters one after another
+     */
+    std::vector<uint16_t> indices;
+
+    /**
+     * Assign lights to the clusters of a view
+     *
+     * @param lights lights in world space, the more important ones first
+     * @param view view matrix
+     * @param projection perspective projection matrix
+     * @param near near plane distance of the projection
+     * @param far far plane distance of the projection
+     */
+    void assign(std::vector<PointLight> const &lights, glm::mat4 const &view, glm::mat4 const &projection,
+                float near, float far);
+
+    /**
+     * Get the factors the shaders turn a fragment into its cluster with: tile = gl_FragCoord.xy * xy,
+     * slice = log(depth) * z + w
+     *
+     * @param width width of the viewport in pixels
+     * @param height height of the viewport in pixels
+     * @return scale and bias
+     */
+    glm::vec4 getScale(int width, int height) const;
+};
+
+
+#endif //OPENGL_TEMPLATE_LIGHT_CLUSTERS_H
@@ -0,0 +1,193 @@
+#include "platform_bounds.h"
+
+#include <cmath>
+
+#include "world.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BOUNDS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOUNDS_SSE
+#endif
+
+void PlatformBounds::reset(size_t count) {
+    for (std::vector<float> *values: {&minX, &maxX, &minY, &maxY, &minZ, &maxZ}) {
+        values->clear();
+        values->reserve(count);
+    }
+    platform.clear();
+    platform.reserve(count);
+}
+
+void PlatformBounds::add(Platform const &p, uint32_t index) {
+    glm::vec3 lower = p.pos - p.size;
+    glm::vec3 upper = p.pos + p.size;
+    minX.push_back(lower.x);
+    maxX.push_back(upper.x);
+    minY.push_back(lower.y);
+    maxY.push_back(upper.y);
+    minZ.push_back(lower.z);
+    maxZ.push_back(upper.z);
+    platform.push_back(index);
+}
+
+size_t PlatformBounds::size() const {
+    return platform.size();
+}
+
+/**
+ * Take box i as hit if its top is strictly higher, so the first of several equally high boxes wins. A top face at
+ * the start height is hit at time 0, the box may have ended the last movement exactly on it.
+ */
+static inline void testBox(PlatformBounds const &b, size_t i, float left, float right, float back, float front,
+                           float top, float bottom, glm::vec3 movement, PlatformHit &hit, bool &found) {
+    float height = b.maxY[i];
+    if (!(height <= top && height > bottom && (!found || height > hit.height))) return;
+
+    // Horizontal position when the bottom face passes the top face
+    float time = (top - height) / -movement.y;
+    float x = movement.x * time, z = movement.z * time;
+    if (left + x < b.maxX[i] && right + x > b.minX[i] && back + z < b.maxZ[i] && front + z > b.minZ[i]) {
+        hit.index = b.platform[i];
+        hit.height = height;
+        hit.time = time;
+        found = true;
+    }
+}
+
+void sweepDownBoundsScalar(PlatformBounds const &bounds, size_t first, size_t end, glm::vec3 origin,
+                           glm::vec2 halfSize, glm::vec3 movement, PlatformHit &hit, bool &found) {
+    float left = origin.x - halfSize.x, right = origin.x + halfSize.x;
+    float back = origin.z - halfSize.y, front = origin.z + halfSize.y;
+    float bottom = origin.y + movement.y;
+    for (size_t i = first; i < end; i++) {
+        testBox(bounds, i, left, right, back, front, origin.y, bottom, movement, hit, found);
+    }
+}
+
+void sweepDownBounds(PlatformBounds const &bounds, size_t first, size_t end, glm::vec3 origin, glm::vec2 halfSize,
+                     glm::vec3 movement, PlatformHit &hit, bool &found) {
+    float left = origin.x - halfSize.x, right = origin.x + halfSize.x;
+    float back = origin.z - halfSize.y, front = origin.z + halfSize.y;
+    float bottom = origin.y + movement.y;
+    size_t i = first;
+
+#if defined(BOUNDS_AVX2) || defined(BOUNDS_SSE)
+    // Every lane keeps its highest hit and the first box with it, strictly higher tops replace it like in the
+    // scalar loop. The lanes are combined at the end, lower boxes first on equal heights.
+#ifdef BOUNDS_AVX2
+    const int lanes = 8;
+    typedef __m256 Floats;
+    typedef __m256i Ints;
+#define SET1(x) _mm256_set1_ps(x)
+#define LOAD(p) _mm256_loadu_ps(p)
+#define AND(a, b) _mm256_and_ps(a, b)
+#define ADD(a, b) _mm256_add_ps(a, b)
+#define SUB(a, b) _mm256_sub_ps(a, b)
+#define MUL(a, b) _mm256_mul_ps(a, b)
+#define DIV(a, b) _mm256_div_ps(a, b)
+#define LESS(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define LESS_EQUAL(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define MASK(a) _mm256_movemask_ps(a)
+#define SELECT(a, b, mask) _mm256_blendv_ps(a, b, mask)
+#define SELECT_INT(a, b, mask) _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), mask))
+#define STORE(p, a) _mm256_storeu_ps(p, a)
+#define STORE_INT(p, a) _mm256_storeu_si256((Ints *) (p), a)
+    Ints position = _mm256_add_epi32(_mm256_set1_epi32((int) i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const Ints step = _mm256_set1_epi32(lanes);
+#define ADVANCE(a) _mm256_add_epi32(a, step)
+#else
+    const int lanes = 4;
+    typedef __m128 Floats;
+    typedef __m128i Ints;
+#define SET1(x) _mm_set1_ps(x)
+#define LOAD(p) _mm_loadu_ps(p)
+#define AND(a, b) _mm_and_ps(a, b)
+#define ADD(a, b) _mm_add_ps(a, b)
+#define SUB(a, b) _mm_sub_ps(a, b)
+#define MUL(a, b) _mm_mul_ps(a, b)
+#define DIV(a, b) _mm_div_ps(a, b)
+#define LESS(a, b) _mm_cmplt_ps(a, b)
+#define LESS_EQUAL(a, b) _mm_cmple_ps(a, b)
+#define MASK(a) _mm_movemask_ps(a)
+#define SELECT(a, b, mask) _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b))
+#define SELECT_INT(a, b, mask) _mm_castps_si128(SELECT(_mm_castsi128_ps(a), _mm_castsi128_ps(b), mask))
+#define STORE(p, a) _mm_storeu_ps(p, a)
+#define STORE_INT(p, a) _mm_storeu_si128((Ints *) (p), a)
+    Ints position = _mm_add_epi32(_mm_set1_epi32((int) i), _mm_setr_epi32(0, 1, 2, 3));
+    const Ints step = _mm_set1_epi32(lanes);
+#define ADVANCE(a) _mm_add_epi32(a, step)
+#endif
+
+    const Floats vLeft = SET1(left), vRight = SET1(right), vBack = SET1(back), vFront = SET1(front);
+    const Floats vTop = SET1(origin.y), vBottom = SET1(bottom), vFall = SET1(-movement.y);
+    const Floats vMoveX = SET1(movement.x), vMoveZ = SET1(movement.z);
+    Floats bestHeight = SET1(found ? hit.height : -INFINITY);
+    Ints bestPosition = position;
+    bool improved = false;
+
+    for (; i + lanes <= end; i += lanes, position = ADVANCE(position)) {
+        // Most top faces are far from the height band of the movement, the other arrays are only read if one isn't
+        Floats height = LOAD(&bounds.maxY[i]);
+        Floats inside = AND(AND(LESS_EQUAL(height, vTop), LESS(vBottom, height)), LESS(bestHeight, height));
+        if (!MASK(inside)) continue;
+
+        // Same operations as testBox, so both find the same boxes
+        Floats time = DIV(SUB(vTop, height), vFall);
+        Floats x = MUL(vMoveX, time), z = MUL(vMoveZ, time);
+        inside = AND(inside, AND(LESS(ADD(vLeft, x), LOAD(&bounds.maxX[i])), LESS(LOAD(&bounds.minX[i]), ADD(vRight, x))));
+        inside = AND(inside, AND(LESS(ADD(vBack, z), LOAD(&bounds.maxZ[i])), LESS(LOAD(&bounds.minZ[i]), ADD(vFront, z))));
+        if (MASK(inside)) {
+            bestHeight = SELECT(bestHeight, height, inside);
+            bestPosition = SELECT_INT(bestPosition, position, inside);
+            improved = true;
+        }
+    }
+
+    if (improved) {
+        float heights[lanes];
+        int32_t positions[lanes];
+        STORE(heights, bestHeight);
+        STORE_INT(positions, bestPosition);
+
+        // Lanes still at the incoming height never had a hit
+        int best = -1;
+        for (int lane = 0; lane < lanes; lane++) {
+            if (!(heights[lane] > (found ? hit.height : -INFINITY))) continue;
+            if (best < 0 || heights[lane] > heights[best] ||
+                (heights[lane] == heights[best] && positions[lane] < positions[best])) {
+                best = lane;
+            }
+        }
+        if (best >= 0) {
+            hit.index = bounds.platform[positions[best]];
+            hit.height = heights[best];
+            hit.time = (origin.y - hit.height) / -movement.y;
+            found = true;
+        }
+    }
+
+#undef SET1
+#undef LOAD
+#undef AND
+#undef ADD
+#undef SUB
+#undef MUL
+#undef DIV
+#undef LESS
+#undef LESS_EQUAL
+#undef MASK
+#undef SELECT
+#undef SELECT_INT
+#undef STORE
+#undef STORE_INT
+#undef ADVANCE
+#endif
+
+    // The boxes that don't fill a whole iteration
+    for (; i < end; i++) {
+        testBox(bounds, i, left, right, back, front, origin.y, bottom, movement, hit, found);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef OPENGL_TEMPLATE_PLATFORM_BOUNDS_H
+#define OPENGL_TEMPLATE_PLATFORM_BOUNDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Platform;
+
+/**
+ * Result of a downward ray cast against the platforms
+ */
+struct PlatformHit {
+    /**
+     * Index of the hit platform in the platform list the grid was built from
+     */
+    size_t index;
+
+    /**
+     * Height of the top face that was hit
+     */
+    float height;
+
+    /**
+     * Time of impact as fraction of the movement, from 0 at the start to 1 at the end
+     */
+    float time;
+};
+
+/**
+ * Bounding boxes of platforms as structure of arrays, so several platforms are tested with one SIMD instruction
+ */
+struct PlatformBounds {
+    /**
+     * Minimum and maximum corner of every box, maxY is the top face
+     */
+    std::vector<float> minX, maxX;
+    std::vector<float> minY, maxY;
+    std::vector<float> minZ, maxZ;
+
+    /**
+     * Index of the platform every box belongs to
+     */
+    std::vector<uint32_t> platform;
+
+    /**
+     * Remove all boxes and reserve space for count boxes
+     *
+     * @param count expected number of boxes
+     */
+    void reset(size_t count);
+
+    /**
+     * Append the box of a platform
+     *
+     * @param p platform
+     * @param index index of the platform
+     */
+    void add(Platform const &p, uint32_t index);
+
+    /**
+     * Number of boxes
+     *
+     * @return number of boxes
+     */
+    size_t size() const;
+};
+
+/**
+ * Sweep the bottom face of a box along a downward movement against the boxes first to end and find the first
+ * top face it lands on. The face lands on a top face if it overlaps it horizontally at the moment it passes
+ * its height, or at the start if it is already at that height. Side contacts don't count. Tests eight boxes per iteration with AVX2 and four with SSE where
+ * available. Every implementation finds the same box.
+ *
+ * @param bounds boxes to test
+ * @param first first box
+ * @param end box after the last one
+ * @param origin center of the bottom face of the moving box at the start
+ * @param halfSize half size of the moving box in x and z direction
+ * @param movement movement of the box, its y must be negative
+ * @param hit first hit so far, only replaced by a strictly higher, which is an earlier, top face
+ * @param found true if hit already holds a hit, set if a box was hit
+ */
+void sweepDownBounds(PlatformBounds const &bounds, size_t first, size_t end, glm::vec3 origin, glm::vec2 halfSize,
+                     glm::vec3 movement, PlatformHit &hit, bool &found);
+
+/**
+ * Same as sweepDownBounds, one box at a time
+ */
+void sweepDownBoundsScalar(PlatformBounds const &bounds, size_t first, size_t end, glm::vec3 origin,
+                           glm::vec2 halfSize, glm::vec3 movement, PlatformHit &hit, bool &found);
+
+
+#endif //OPENGL_TEMPLATE_PLATFORM_BOUNDS_H
@@ -0,0 +1,157 @@
+#include "platform_chain.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/jobsystem.hpp"
+
+/**
+ * Fixed point resolution of positions, 2^-24 units
+ */
+static const double fixedScale = 16777216.;
+
+/**
+ * Chains shorter than this are generated on the calling thread
+ */
+static const size_t parallelThreshold = 1 << 16;
+
+/**
+ * Counter based random numbers, SplitMix64 applied to seed and counter
+ */
+static uint64_t hash(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+double PlatformChain::random(size_t platform, unsigned draw) const {
+    return (hash(seed ^ hash(platform * 8 + draw)) % 100) / 100.;
+}
+
+glm::vec3 PlatformChain::sizeOf(size_t platform) const {
+    if (platform == 0) return glm::vec3(.5, .02, .5);
+    return glm::vec3(random(platform, 1) * .7 + .1, .02, random(platform, 2) * .7 + .1);
+}
+
+void PlatformChain::offsetOf(size_t platform, int64_t offset[3]) const {
+    glm::vec3 previous = sizeOf(platform - 1);
+    glm::vec3 size = sizeOf(platform);
+
+    double y_offset = random(platform, 0) * 0.4 + .1;
+
+    double max_offs_x = .8 + previous.x + size.x;
+    double max_offs_z = .8 + previous.z + size.z;
+
+    double x_offset = random(platform, 3) * 2 * max_offs_x - max_offs_x;
+    double z_offset = random(platform, 4) * 2 * max_offs_z - max_offs_z;
+
+    offset[0] = std::llround(x_offset * fixedScale);
+    offset[1] = std::llround(y_offset * fixedScale);
+    offset[2] = std::llround(z_offset * fixedScale);
+}
+
+Platform PlatformChain::platformAt(size_t platform, const int64_t fixed[3]) const {
+    return Platform{glm::vec3(fixed[0] / fixedScale, fixed[1] / fixedScale, fixed[2] / fixedScale), sizeOf(platform)};
+}
+
+Platform PlatformChain::first() const {
+    const int64_t origin[3] = {0, 0, 0};
+    return platformAt(0, origin);
+}
+
+Platform PlatformChain::next() {
+    int64_t offset[3];
+    offsetOf(++index, offset);
+    for (int k = 0; k < 3; k++) position[k] += offset[k];
+    return platformAt(index, position);
+}
+
+void PlatformChain::generate(size_t count, std::vector<Platform> &out, JobSystem *jobs) const {
+    out.resize(count);
+    if (count == 0) return;
+    if (jobs == nullptr) jobs = &JobSystem::global();
+
+    // A few blocks per thread so idle workers can steal, short chains are a single block
+    size_t blocks = count < parallelThreshold ? 1 : 4 * jobs->getThreadCount();
+    size_t blockSize = (count + blocks - 1) / blocks;
+    std::vector<int64_t> blockSums(3 * (blocks + 1), 0);
+
+    // Parallel prefix sum in three steps: sum up every block, scan the block sums, then write every
+    // block starting at its scanned sum. Offsets are computed twice instead of being stored.
+    // A single block starts at the origin, nothing to sum up
+    if (blocks > 1) {
+        jobs->parallelFor(blocks, 1, [&](size_t firstBlock, size_t endBlock) {
+            int64_t offset[3];
+            for (size_t block = firstBlock; block < endBlock; block++) {
+                int64_t *sum = &blockSums[3 * block];
+                size_t to = std::min(count, (block + 1) * blockSize);
+                for (size_t i = std::max<size_t>(block * blockSize, 1); i < to; i++) {
+                    offsetOf(i, offset);
+                    for (int k = 0; k < 3; k++) sum[k] += offset[k];
+                }
+            }
+        });
+    }
+
+    // Exclusive scan, block t now holds the position of the platform before its first one
+    int64_t running[3] = {0, 0, 0};
+    for (size_t block = 0; block < blocks; block++) {
+        for (int k = 0; k < 3; k++) {
+            int64_t blockSum = blockSums[3 * block + k];
+            blockSums[3 * block + k] = running[k];
+            running[k] += blockSum;
+        }
+    }
+
+    jobs->parallelFor(blocks, 1, [&](size_t firstBlock, size_t endBlock) {
+        int64_t offset[3];
+        for (size_t block = firstBlock; block < endBlock; block++) {
+            int64_t fixed[3] = {blockSums[3 * block], blockSums[3 * block + 1], blockSums[3 * block + 2]};
+            size_t to = std::min(count, (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < to; i++) {
+                if (i > 0) {
+                    offsetOf(i, offset);
+                    for (int k = 0; k < 3; k++) fixed[k] += offset[k];
+                }
+                out[i] = platformAt(i, fixed);
+            }
+        }
+    });
+}
+
+void PlatformChain::generateMoving(std::vector<Platform> const &platforms, size_t interval, float period,
+                                   std::vector<MovingPlatform> &out) const {
+    out.clear();
+
+    // Draws of their own, the chain itself stays the same
+    PlatformChain motion(hash(seed ^ 0x4d6f76696e67ULL));
+    const double pi = 3.14159265358979323846;
+
+    for (size_t i = interval / 2; i < platforms.size(); i += interval) {
+        Platform const &anchor = platforms[i];
+        double side = motion.random(i, 0) < .5 ? -1 : 1;
+        double angle = motion.random(i, 1) * 2 * pi;
+        double kind = motion.random(i, 2);
+
+        MovingPlatform moving;
+        moving.size = glm::vec3(.15f, .02f, .15f);
+        moving.pos = anchor.pos + glm::vec3((float) (side * (anchor.size.x + .6)), .1f, 0);
+        if (kind < .4) {
+            moving.sine = glm::vec3((float) (std::cos(angle) * .3), 0, (float) (std::sin(angle) * .3));
+            moving.cosine = glm::vec3(0);
+        } else if (kind < .7) {
+            moving.sine = glm::vec3(0, .15f, 0);
+            moving.cosine = glm::vec3(0);
+        } else {
+            moving.sine = glm::vec3(.25f, 0, 0);
+            moving.cosine = glm::vec3(0, 0, .25f);
+        }
+
+        // 3 to 8 cycles per period
+        int cycles = 3 + (int) (motion.random(i, 3) * 6);
+        moving.speed = (float) (2 * pi * cycles / period);
+        moving.phase = (float) (motion.random(i, 4) * 2 * pi);
+        out.push_back(moving);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef OPENGL_TEMPLATE_PLATFORM_CHAIN_H
+#define OPENGL_TEMPLATE_PLATFORM_CHAIN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "world.h"
+
+class JobSystem;
+
+/**
+ * Generator for the chain of platforms, every platform is placed relative to the previous one.
+ *
+ * The random numbers of a platform only depend on the seed and the index of the platform, so the offsets
+ * of all platforms can be computed independently. Positions are summed up in fixed point, which makes the
+ * result bit-identical no matter how the sum is split between threads.
+ */
+class PlatformChain {
+    /**
+     * Seed of the chain
+     */
+    uint64_t seed;
+
+    /**
+     * Index of the last platform returned by next() and its position in fixed point
+     */
+    size_t index = 0;
+    int64_t position[3] = {0, 0, 0};
+
+    /**
+     * Random number in [0, 1) in steps of 1/100 for one draw of a platform
+     *
+     * @param platform index of the platform
+     * @param draw number of the draw for this platform
+     * @return random number
+     */
+    double random(size_t platform, unsigned draw) const;
+
+    /**
+     * Get the size of a platform
+     *
+     * @param platform index of the platform
+     * @return size of the platform
+     */
+    glm::vec3 sizeOf(size_t platform) const;
+
+    /**
+     * Get the offset of a platform from the previous one in fixed point
+     *
+     * @param platform index of the platform, at least 1
+     * @param offset receives the offset
+     */
+    void offsetOf(size_t platform, int64_t offset[3]) const;
+
+    /**
+     * Convert a fixed point position into a platform
+     *
+     * @param platform index of the platform
+     * @param fixed position in fixed point
+     * @return platform
+     */
+    Platform platformAt(size_t platform, const int64_t fixed[3]) const;
+
+public:
+    /**
+     * Constructor
+     *
+     * @param seed seed of the chain, the same seed always gives the same chain
+     */
+    explicit PlatformChain(uint64_t seed) : seed(seed) {};
+
+    /**
+     * Get the starting platform at the origin
+     *
+     * @return first platform of the chain
+     */
+    Platform first() const;
+
+    /**
+     * Generate the next platform of the chain
+     *
+     * @return new platform
+     */
+    Platform next();
+
+    /**
+     * Generate the first platforms of the chain at once, split into jobs
+     *
+     * @param count number of platforms including the first one
+     * @param out receives the platforms, identical to first() followed by next() calls
+     * @param jobs job system that runs the blocks, nullptr for the shared one
+     */
+    void generate(size_t count, std::vector<Platform> &out, JobSystem *jobs = nullptr) const;
+
+    /**
+     * Generate the moving platforms of a chain, one beside every interval-th platform. They move on a line
+     * sideways, up and down or on a circle.
+     *
+     * @param platforms chain from generate()
+     * @param interval distance of the platforms that get a moving platform
+     * @param period time in which every moving platform completes a whole number of cycles
+     * @param out receives the moving platforms
+     */
+    void generateMoving(std::vector<Platform> const &platforms, size_t interval, float period,
+                        std::vector<MovingPlatform> &out) const;
+};
+
+
+#endif //OPENGL_TEMPLATE_PLATFORM_CHAIN_H
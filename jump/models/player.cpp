@@ -1,117 +1,177 @@
 #include "player.h"
 
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 
-void Player::updatePlayer(GLFWwindow *window, glm::vec3 _direction, glm::vec3 _right, World const &world, float delta) {
-    static double lastStart = glfwGetTime();
-
+void Player::updatePlayer(PlayerInput const &input, glm::vec3 _direction, glm::vec3 _right, World const &world,
+                          float delta) {
     direction = _direction;
     right = _right;
 
+    previousPos = pos;
+    previousAngleRL = angleRL;
+    previousAngleFB = angleFB;
+
+    if (delta != smoothingDelta) {
+        smoothingDelta = delta;
+        angleSmoothing = 1 - pow(anglePower, delta);
+        speedSmoothing = 1 - pow(speedPower, delta);
+    }
+
     speedFBtarget = 0;
     speedRLtarget = 0;
 
     angleFBtarget = 0;
     angleRLtarget = 0;
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.forward) {
         speedFBtarget += 2.f;
         angleFBtarget += .2f;
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.backward) {
         speedFBtarget -= 2.f;
         angleFBtarget -= .2f;
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.left) {
         speedRLtarget -= 2.f;
         angleRLtarget += .2f;
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.right) {
         speedRLtarget += 2.f;
         angleRLtarget -= .2f;
     }
 
-    speedFB = speedFB + (speedFBtarget - speedFB) * (1 - pow(speedPower, delta));
-    speedRL = speedRL + (speedRLtarget - speedRL) * (1 - pow(speedPower, delta));
+    speedFB = speedFB + (speedFBtarget - speedFB) * speedSmoothing;
+    speedRL = speedRL + (speedRLtarget - speedRL) * speedSmoothing;
 
     if (speedFB != 0)
         pos += normalize(direction * glm::vec3(1, 0, 1)) * speedFB * delta;
     if (speedRL != 0)
         pos += normalize(right * glm::vec3(1, 0, 1)) * speedRL * delta;
 
-    angleFB = angleFB + (angleFBtarget - angleFB) * (1 - pow(anglePower, delta));
-    angleRL = angleRL + (angleRLtarget - angleRL) * (1 - pow(anglePower, delta));
+    angleFB = angleFB + (angleFBtarget - angleFB) * angleSmoothing;
+    angleRL = angleRL + (angleRLtarget - angleRL) * angleSmoothing;
 
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+    if (input.toggleFlying) {
         if (canToggle) {
             isFalling = !isFalling;
             velocityUp = 2;
         }
         canToggle = false;
-    }
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_RELEASE) {
+    } else {
         canToggle = true;
     }
 
     if (isFalling) {
-        pos.y += velocityUp * delta;
+        // Exact under constant gravity, so arcs are as high with any step size
+        pos.y += (velocityUp - 2 * delta) * delta;
         velocityUp -= 4 * delta;
 
-        // Collision
-        if (velocityUp < 0) {
-            for (Platform p: world.platforms) {
-                float upperX = p.pos.x + p.size.x;
-                float lowerX = p.pos.x - p.size.x;
-                float upperZ = p.pos.z + p.size.z;
-                float lowerZ = p.pos.z - p.size.z;
-                float upperY = p.pos.y + p.size.y;
-                float lowerY = p.pos.y - p.size.y;
-                if (pos.x - size.x < upperX && pos.x + size.x > lowerX && pos.z - size.z < upperZ &&
-                    pos.z + size.z > lowerZ) {
-                    if (pos.y - size.y < upperY && pos.y - size.y - velocityUp * delta > upperY) {
-//                && pos.y - size.y / 2.f < upperY && pos.y + size.y / 2.f > lowerY) {
-                        pos.y = upperY + size.y;
-                        velocityUp = -velocityUp / 1.7f;
-                        if (velocityUp < 2) {
-                            velocityUp = 2;
-                        }
-                        numOfJumps++;
-                        if (numOfJumps == 20) {
-                            numOfJumps = 0;
-                            savedPosition = pos;
-                        }
-                        break;
-                    }
-                }
+        // Collision, sweep the bottom of the player along the whole movement of this step, horizontal part
+        // included, so it lands on every platform it passes however long the step is
+        glm::vec3 movement = pos - previousPos;
+        glm::vec3 bottom = previousPos - glm::vec3(0, size.y, 0);
+        glm::vec2 halfSize(size.x, size.z);
+        PlatformHit hit;
+        bool landed = movement.y < 0 && world.grid.sweepDown(bottom, halfSize, movement, hit);
+
+        // Moving platforms can also come up from below, the earlier hit counts
+        PlatformHit movingHit;
+        if (world.sweepMovingPlatforms(bottom, halfSize, movement, delta, movingHit) &&
+            (!landed || movingHit.time < hit.time)) {
+            hit = movingHit;
+            landed = true;
+        }
+
+        if (landed) {
+            // Bounce with the velocity at the time of impact, gravity only acts for the rest of the step after
+            // that, so the bounce height doesn't depend on the step size
+            float remaining = (1 - hit.time) * delta;
+            velocityUp = -(velocityUp + 4 * remaining) / 1.7f;
+            if (velocityUp < 2) {
+                velocityUp = 2;
+            }
+
+            // The horizontal movement goes on
+            pos.y = hit.height + size.y + (velocityUp - 2 * remaining) * remaining;
+            velocityUp -= 4 * remaining;
+            numOfJumps++;
+            totalJumps++;
+            if (numOfJumps == 20) {
+                numOfJumps = 0;
+                savedPosition = pos;
             }
         }
 
-        if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        if (input.jump) {
             pos = glm::vec3(0, 0.25, 0);
             velocityUp = 0;
             numOfJumps = 0;
             savedPosition = pos;
         }
-        if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS || pos.y < -.2) {
+        if (input.savepoint || pos.y < world.getFallHeight()) {
             numOfJumps = 0;
             pos = savedPosition + glm::vec3(0, 0.25, 0);
             velocityUp = 0;
         }
     } else {
-        if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        if (input.jump) {
             pos.y += 2 * delta;
         }
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+        if (input.down) {
             pos.y -= 2 * delta;
         }
     }
+}
+
+glm::vec3 Player::getPosition(float interpolation) const {
+    return glm::mix(previousPos, pos, interpolation);
+}
+
+glm::mat4 Player::getModelMatrix(float interpolation) const {
+    float RL = glm::mix(previousAngleRL, angleRL, interpolation);
+    float FB = glm::mix(previousAngleFB, angleFB, interpolation);
+    return glm::translate(glm::mat4(1.f), getPosition(interpolation)) *
+           glm::rotate(glm::mat4(1.0f), -RL, normalize(direction * glm::vec3(1, 0, 1))) *
+           glm::rotate(glm::mat4(1.0f), -FB, normalize(right * glm::vec3(1, 0, 1)));
+}
 
-    lastStart = glfwGetTime();
+glm::vec3 Player::getSavedPosition() const {
+    return savedPosition;
+}
+
+int Player::getTotalJumps() const {
+    return totalJumps;
+}
+
+/**
+ * Add raw bytes to an FNV-1a hash
+ */
+template<typename T>
+static void hashBytes(uint64_t &hash, T const &value) {
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    for (unsigned char byte: bytes) {
+        hash ^= byte;
+        hash *= 0x100000001B3ULL;
+    }
 }
 
-glm::mat4 Player::getModelMatrix() const {
-    return glm::translate(glm::mat4(1.f), pos) *
-           glm::rotate(glm::mat4(1.0f), -angleRL, normalize(direction * glm::vec3(1, 0, 1))) *
-           glm::rotate(glm::mat4(1.0f), -angleFB, normalize(right * glm::vec3(1, 0, 1)));
+uint64_t Player::hashState() const {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hashBytes(hash, pos);
+    hashBytes(hash, velocityUp);
+    hashBytes(hash, angleRL);
+    hashBytes(hash, angleFB);
+    hashBytes(hash, speedFB);
+    hashBytes(hash, speedRL);
+    hashBytes(hash, direction);
+    hashBytes(hash, right);
+    hashBytes(hash, isFalling);
+    hashBytes(hash, canToggle);
+    hashBytes(hash, numOfJumps);
+    hashBytes(hash, totalJumps);
+    hashBytes(hash, savedPosition);
+    return hash;
 }
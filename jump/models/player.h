@@ -1,32 +1,33 @@
 #ifndef OPENGL_TEMPLATE_PLAYER_H
 #define OPENGL_TEMPLATE_PLAYER_H
 
+#include <cstdint>
 #include <glm/glm.hpp>
-#include <glfw3.h>
 
+#include "input.h"
 #include "world.h"
 
 class Player {
     /**
      * Velocity in upward direction
      */
-    float velocityUp;
+    float velocityUp = 0;
 
     /**
      * Current and target angles for interpolation of player rotation (front-back FB, right-left RL)
      */
-    float angleRL;
-    float angleFB;
-    float angleRLtarget;
-    float angleFBtarget;
+    float angleRL = 0;
+    float angleFB = 0;
+    float angleRLtarget = 0;
+    float angleFBtarget = 0;
 
     /**
      * Current and target speed for interpolation of player speed (front-back FB, right-left RL)
      */
-    float speedFB;
-    float speedRL;
-    float speedFBtarget;
-    float speedRLtarget;
+    float speedFB = 0;
+    float speedRL = 0;
+    float speedFBtarget = 0;
+    float speedRLtarget = 0;
 
     /**
      * Interpolation powers for angle and speed
@@ -34,11 +35,25 @@ class Player {
     float anglePower = 0.0001;
     float speedPower = 0.00001;
 
+    /**
+     * Interpolation factors for the last step length, pow() is only evaluated again if the step length changes
+     */
+    float smoothingDelta = -1;
+    float angleSmoothing;
+    float speedSmoothing;
+
+    /**
+     * Position and angles before the last update, for interpolation between two updates when rendering
+     */
+    glm::vec3 previousPos = glm::vec3(0, 0.25, 0);
+    float previousAngleRL = 0;
+    float previousAngleFB = 0;
+
     /**
      * Vectors for forward and right direction
      */
-    glm::vec3 direction;
-    glm::vec3 right;
+    glm::vec3 direction = glm::vec3(0, 0, -1);
+    glm::vec3 right = glm::vec3(1, 0, 0);
 
     /**
      * True if play is falling and not in "god" mode
@@ -55,6 +70,11 @@ class Player {
      */
     int numOfJumps = 0;
 
+    /**
+     * Number of landings on a platform since the start
+     */
+    int totalJumps = 0;
+
     /**
      * Last saved position
      */
@@ -64,13 +84,13 @@ public:
     /**
      * Update player state
      *
-     * @param window OpenGL window
+     * @param input state of the controls
      * @param direction forward direction vector
      * @param right right direction vector
-     * @param world game world object
+     * @param world game world object, its moving platforms are at the start of the step
      * @param delta delta time of last game loop iteration
      */
-    void updatePlayer(GLFWwindow *window, glm::vec3 direction, glm::vec3 right, World const &world, float delta);
+    void updatePlayer(PlayerInput const &input, glm::vec3 direction, glm::vec3 right, World const &world, float delta);
 
     /**
      * Current position
@@ -82,12 +102,42 @@ public:
      */
     glm::vec3 size = glm::vec3(.05f);
 
+    /**
+     * Get position of player between the last two updates
+     *
+     * @param interpolation 0 for the state before the last update, 1 for the current state
+     * @return interpolated position
+     */
+    glm::vec3 getPosition(float interpolation = 1) const;
+
     /**
      * Get model matrix of player
      *
+     * @param interpolation 0 for the state before the last update, 1 for the current state
      * @return model matrix
      */
-    glm::mat4 getModelMatrix() const;
+    glm::mat4 getModelMatrix(float interpolation = 1) const;
+
+    /**
+     * Get the last saved position
+     *
+     * @return position of the last savepoint
+     */
+    glm::vec3 getSavedPosition() const;
+
+    /**
+     * Get number of landings on a platform since the start
+     *
+     * @return number of landings
+     */
+    int getTotalJumps() const;
+
+    /**
+     * Hash of the complete simulation state, to detect when two runs diverge
+     *
+     * @return 64 bit FNV-1a hash
+     */
+    uint64_t hashState() const;
 };
 
 
@@ -0,0 +1,137 @@
+#include "replay.h"
+
+#include <cstring>
+
+/**
+ * File layout: magic, version, header, then one record per tick
+ * (1 byte of input bits, cursor x and y as floats, 8 bytes of state hash)
+ */
+static const char replayMagic[4] = {'G', 'J', 'R', 'P'};
+
+/**
+ * Raised whenever the simulation or the world generation changes, recordings of older versions would diverge.
+ * 2: swept landing with the bounce at the time of impact, moving platforms
+ */
+static const uint32_t replayVersion = 2;
+
+static uint8_t packInput(PlayerInput const &input) {
+    return (uint8_t) (input.forward << 0 | input.backward << 1 | input.left << 2 | input.right << 3 |
+                      input.toggleFlying << 4 | input.jump << 5 | input.down << 6 | input.savepoint << 7);
+}
+
+static PlayerInput unpackInput(uint8_t bits) {
+    PlayerInput input;
+    input.forward = bits & 1 << 0;
+    input.backward = bits & 1 << 1;
+    input.left = bits & 1 << 2;
+    input.right = bits & 1 << 3;
+    input.toggleFlying = bits & 1 << 4;
+    input.jump = bits & 1 << 5;
+    input.down = bits & 1 << 6;
+    input.savepoint = bits & 1 << 7;
+    return input;
+}
+
+ReplayRecorder::~ReplayRecorder() {
+    close();
+}
+
+bool ReplayRecorder::open(const char *path, ReplayHeader const &header) {
+    close();
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Impossible to open %s for recording\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(replayMagic, 1, sizeof(replayMagic), file) == sizeof(replayMagic) &&
+              fwrite(&replayVersion, sizeof(replayVersion), 1, file) == 1 &&
+              fwrite(&header.seed, sizeof(header.seed), 1, file) == 1 &&
+              fwrite(&header.numOfPlatforms, sizeof(header.numOfPlatforms), 1, file) == 1 &&
+              fwrite(&header.simulationStep, sizeof(header.simulationStep), 1, file) == 1;
+    if (!ok) {
+        fprintf(stderr, "Failed to write the replay header to %s\n", path);
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void ReplayRecorder::record(ReplayTick const &tick) {
+    if (file == nullptr) return;
+
+    unsigned char record[17];
+    record[0] = packInput(tick.input);
+    memcpy(record + 1, &tick.cursorX, 4);
+    memcpy(record + 5, &tick.cursorY, 4);
+    memcpy(record + 9, &tick.stateHash, 8);
+
+    // A full disk would otherwise leave a truncated recording behind without notice
+    if (fwrite(record, 1, sizeof(record), file) != sizeof(record)) {
+        fprintf(stderr, "Failed to write the replay, recording stopped\n");
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool ReplayRecorder::close() {
+    if (file == nullptr) return false;
+
+    // Buffered ticks are only written here
+    bool ok = fclose(file) == 0;
+    file = nullptr;
+    if (!ok) fprintf(stderr, "Failed to finish the replay file\n");
+    return ok;
+}
+
+bool ReplayRecorder::isOpen() const {
+    return file != nullptr;
+}
+
+ReplayPlayer::~ReplayPlayer() {
+    close();
+}
+
+bool ReplayPlayer::open(const char *path) {
+    close();
+    file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Impossible to open replay %s\n", path);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version;
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              fread(&version, sizeof(version), 1, file) == 1 &&
+              fread(&header.seed, sizeof(header.seed), 1, file) == 1 &&
+              fread(&header.numOfPlatforms, sizeof(header.numOfPlatforms), 1, file) == 1 &&
+              fread(&header.simulationStep, sizeof(header.simulationStep), 1, file) == 1;
+    if (!ok || memcmp(magic, replayMagic, sizeof(magic)) != 0 || version != replayVersion) {
+        fprintf(stderr, "%s is not a replay of version %u\n", path, replayVersion);
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ReplayPlayer::next(ReplayTick &tick) {
+    unsigned char record[17];
+    if (file == nullptr || fread(record, 1, sizeof(record), file) != sizeof(record)) return false;
+
+    tick.input = unpackInput(record[0]);
+    memcpy(&tick.cursorX, record + 1, 4);
+    memcpy(&tick.cursorY, record + 5, 4);
+    memcpy(&tick.stateHash, record + 9, 8);
+    return true;
+}
+
+void ReplayPlayer::close() {
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+}
+
+bool ReplayPlayer::isOpen() const {
+    return file != nullptr;
+}
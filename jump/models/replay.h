@@ -0,0 +1,130 @@
+#ifndef OPENGL_TEMPLATE_REPLAY_H
+#define OPENGL_TEMPLATE_REPLAY_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "input.h"
+
+/**
+ * Header of a replay file, everything needed to set up the same world again
+ */
+struct ReplayHeader {
+    /**
+     * Seed and number of platforms of the world
+     */
+    uint64_t seed;
+    uint32_t numOfPlatforms;
+
+    /**
+     * Duration of one simulation step
+     */
+    float simulationStep;
+};
+
+/**
+ * Everything that goes into one simulation step, and the player state after it
+ */
+struct ReplayTick {
+    /**
+     * Controls of the player
+     */
+    PlayerInput input;
+
+    /**
+     * Cursor position used for the camera rotation
+     */
+    float cursorX;
+    float cursorY;
+
+    /**
+     * Hash of the player state after the step
+     */
+    uint64_t stateHash;
+};
+
+/**
+ * Writes one tick after the other into a compact binary replay file
+ */
+class ReplayRecorder {
+    FILE *file = nullptr;
+
+public:
+    ~ReplayRecorder();
+
+    /**
+     * Create a replay file
+     *
+     * @param path path of the file
+     * @param header world and step of the recording
+     * @return true if successful
+     */
+    bool open(const char *path, ReplayHeader const &header);
+
+    /**
+     * Append a tick
+     *
+     * @param tick tick to write
+     */
+    void record(ReplayTick const &tick);
+
+    /**
+     * Finish the file
+     *
+     * @return true if a file was open and every tick was written
+     */
+    bool close();
+
+    /**
+     * True while recording
+     *
+     * @return true if a file is open
+     */
+    bool isOpen() const;
+};
+
+/**
+ * Reads the ticks of a replay file back in order
+ */
+class ReplayPlayer {
+    FILE *file = nullptr;
+
+public:
+    /**
+     * Header of the open file
+     */
+    ReplayHeader header;
+
+    ~ReplayPlayer();
+
+    /**
+     * Open a replay file and read its header
+     *
+     * @param path path of the file
+     * @return true if it is a valid replay
+     */
+    bool open(const char *path);
+
+    /**
+     * Read the next tick
+     *
+     * @param tick receives the tick
+     * @return false at the end of the replay
+     */
+    bool next(ReplayTick &tick);
+
+    /**
+     * Close the file
+     */
+    void close();
+
+    /**
+     * True while playing back
+     *
+     * @return true if a file is open
+     */
+    bool isOpen() const;
+};
+
+
+#endif //OPENGL_TEMPLATE_REPLAY_H
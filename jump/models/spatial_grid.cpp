@@ -0,0 +1,128 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "world.h"
+
+size_t SpatialGrid::CellHash::operator()(uint64_t key) const {
+    // Mix the packed coordinates, neighbouring cells only differ in a few low bits
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t) key;
+}
+
+glm::ivec3 SpatialGrid::cellOf(glm::vec3 p) const {
+    return glm::ivec3(glm::floor(p / cellSize));
+}
+
+uint64_t SpatialGrid::key(glm::ivec3 c) {
+    // 21 bits per axis, enough for about a million cells in every direction
+    const uint64_t mask = (1u << 21) - 1;
+    return ((uint64_t) (c.x & mask) << 42) | ((uint64_t) (c.y & mask) << 21) | (uint64_t) (c.z & mask);
+}
+
+void SpatialGrid::build(std::vector<Platform> const &platforms) {
+    cells.clear();
+    cellStart.clear();
+
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    entries.reserve(platforms.size() * 2);
+
+    for (size_t i = 0; i < platforms.size(); i++) {
+        Platform const &p = platforms[i];
+
+        // Empty platform slots of the endless world
+        if (p.size == glm::vec3(0)) continue;
+
+        glm::ivec3 from = cellOf(p.pos - p.size);
+        glm::ivec3 to = cellOf(p.pos + p.size);
+        for (int x = from.x; x <= to.x; x++)
+            for (int y = from.y; y <= to.y; y++)
+                for (int z = from.z; z <= to.z; z++)
+                    entries.emplace_back(key(glm::ivec3(x, y, z)), (uint32_t) i);
+    }
+
+    // Sorting by key (and index) groups every cell into one contiguous run
+    std::sort(entries.begin(), entries.end());
+
+    bounds.reset(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i == 0 || entries[i].first != entries[i - 1].first) {
+            cells[entries[i].first] = (uint32_t) cellStart.size();
+            cellStart.push_back((uint32_t) bounds.size());
+        }
+        bounds.add(platforms[entries[i].second], entries[i].second);
+    }
+    cellStart.push_back((uint32_t) bounds.size());
+}
+
+void SpatialGrid::queryAABB(glm::vec3 min, glm::vec3 max, std::vector<size_t> &out) const {
+    out.clear();
+
+    glm::ivec3 from = cellOf(min);
+    glm::ivec3 to = cellOf(max);
+    for (int x = from.x; x <= to.x; x++) {
+        for (int y = from.y; y <= to.y; y++) {
+            for (int z = from.z; z <= to.z; z++) {
+                auto cell = cells.find(key(glm::ivec3(x, y, z)));
+                if (cell == cells.end()) continue;
+
+                for (uint32_t i = cellStart[cell->second]; i < cellStart[cell->second + 1]; i++) {
+                    if (min.x < bounds.maxX[i] && max.x > bounds.minX[i] &&
+                        min.y < bounds.maxY[i] && max.y > bounds.minY[i] &&
+                        min.z < bounds.maxZ[i] && max.z > bounds.minZ[i]) {
+                        out.push_back(bounds.platform[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Platforms spanning several cells are found more than once
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+bool SpatialGrid::castDown(glm::vec3 origin, glm::vec2 halfSize, float distance, PlatformHit &hit) const {
+    return sweepDown(origin, halfSize, glm::vec3(0, -distance, 0), hit);
+}
+
+bool SpatialGrid::sweepDown(glm::vec3 origin, glm::vec2 halfSize, glm::vec3 movement, PlatformHit &hit) const {
+    bool found = false;
+    if (!(movement.y < 0)) return found;
+
+    // Cells covered by the box over the whole movement
+    glm::vec3 end = origin + movement;
+    glm::ivec3 from = cellOf(glm::vec3(std::min(origin.x, end.x) - halfSize.x, end.y,
+                                       std::min(origin.z, end.z) - halfSize.y));
+    glm::ivec3 to = cellOf(glm::vec3(std::max(origin.x, end.x) + halfSize.x, origin.y,
+                                     std::max(origin.z, end.z) + halfSize.y));
+
+    // Walk the cells from the top, the first layer with a hit contains the nearest top face
+    for (int y = to.y; y >= from.y && !found; y--) {
+        for (int x = from.x; x <= to.x; x++) {
+            for (int z = from.z; z <= to.z; z++) {
+                auto cell = cells.find(key(glm::ivec3(x, y, z)));
+                if (cell == cells.end()) continue;
+
+                sweepDownBounds(bounds, cellStart[cell->second], cellStart[cell->second + 1], origin, halfSize,
+                                movement, hit, found);
+            }
+        }
+    }
+
+    return found;
+}
+
+bool SpatialGrid::castDownAll(glm::vec3 origin, glm::vec2 halfSize, float distance, PlatformHit &hit,
+                              bool vectorized) const {
+    // Copies of a platform in several cells are just tested more than once
+    bool found = false;
+    glm::vec3 movement(0, -distance, 0);
+    if (vectorized) sweepDownBounds(bounds, 0, bounds.size(), origin, halfSize, movement, hit, found);
+    else sweepDownBoundsScalar(bounds, 0, bounds.size(), origin, halfSize, movement, hit, found);
+    return found;
+}
@@ -0,0 +1,119 @@
+#ifndef OPENGL_TEMPLATE_SPATIAL_GRID_H
+#define OPENGL_TEMPLATE_SPATIAL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "platform_bounds.h"
+
+/**
+ * Uniform grid over platform bounding boxes for collision queries
+ */
+class SpatialGrid {
+    /**
+     * Hash for packed cell coordinates
+     */
+    struct CellHash {
+        size_t operator()(uint64_t key) const;
+    };
+
+    /**
+     * Edge length of a grid cell
+     */
+    float cellSize;
+
+    /**
+     * Maps packed cell coordinates to the index of the cell
+     */
+    std::unordered_map<uint64_t, uint32_t, CellHash> cells;
+
+    /**
+     * Boxes of the platforms in all cells, cell i owns the boxes cellStart[i] to cellStart[i + 1]. A platform
+     * has a copy of its box in every cell it overlaps, so a cell is tested without jumping around in memory.
+     */
+    std::vector<uint32_t> cellStart;
+    PlatformBounds bounds;
+
+    /**
+     * Get the cell coordinates of a point
+     *
+     * @param p point in world space
+     * @return integer cell coordinates
+     */
+    glm::ivec3 cellOf(glm::vec3 p) const;
+
+    /**
+     * Pack cell coordinates into a single key
+     *
+     * @param c cell coordinates
+     * @return packed key
+     */
+    static uint64_t key(glm::ivec3 c);
+
+public:
+    /**
+     * Constructor
+     *
+     * @param cellSize edge length of a grid cell
+     */
+    explicit SpatialGrid(float cellSize = 2.f) : cellSize(cellSize) {};
+
+    /**
+     * Rebuild the grid for a list of platforms
+     *
+     * @param platforms platforms to index
+     */
+    void build(std::vector<Platform> const &platforms);
+
+    /**
+     * Collect all platforms overlapping an axis aligned box
+     *
+     * @param min minimum corner of the box
+     * @param max maximum corner of the box
+     * @param out indices of overlapping platforms, sorted and without duplicates
+     */
+    void queryAABB(glm::vec3 min, glm::vec3 max, std::vector<size_t> &out) const;
+
+    /**
+     * Move a box with a horizontal half size straight down and find the first top face it touches
+     *
+     * @param origin center of the bottom face of the box
+     * @param halfSize half size of the box in x and z direction
+     * @param distance maximum distance to move down
+     * @param hit nearest hit, only written if something was hit
+     * @return true if a platform was hit
+     */
+    bool castDown(glm::vec3 origin, glm::vec2 halfSize, float distance, PlatformHit &hit) const;
+
+    /**
+     * Move a box with a horizontal half size along a downward movement and find the first top face it lands on.
+     * Unlike castDown the box may also move horizontally, so it can't pass through platforms however large the
+     * movement is.
+     *
+     * @param origin center of the bottom face of the box at the start
+     * @param halfSize half size of the box in x and z direction
+     * @param movement movement of the box, its y must be negative
+     * @param hit first hit with its time of impact, only written if something was hit
+     * @return true if a platform was hit
+     */
+    bool sweepDown(glm::vec3 origin, glm::vec2 halfSize, glm::vec3 movement, PlatformHit &hit) const;
+
+    /**
+     * Same as castDown, but tests every box without looking at the cells
+     *
+     * @param origin center of the bottom face of the box
+     * @param halfSize half size of the box in x and z direction
+     * @param distance maximum distance to move down
+     * @param hit nearest hit, only written if something was hit
+     * @param vectorized false to test one box at a time
+     * @return true if a platform was hit
+     */
+    bool castDownAll(glm::vec3 origin, glm::vec2 halfSize, float distance, PlatformHit &hit,
+                     bool vectorized = true) const;
+};
+
+
+#endif //OPENGL_TEMPLATE_SPATIAL_GRID_H
@@ -1,56 +1,235 @@
 #include "world.h"
 
-#include <cstdlib>
+#include <algorithm>
+#include <cmath>
 #include <ctime>
 
+#include "common/jobsystem.hpp"
+#include "platform_chain.h"
+#include "world_streamer.h"
+
+const size_t World::chunkSize;
+const size_t World::chunkSlots;
+const size_t World::blockSize;
+const size_t World::movingInterval;
+constexpr float World::motionPeriod;
+
+/**
+ * Worlds with fewer platforms are set up on the calling thread, jobs would cost more than they save
+ */
+static const size_t parallelThreshold = 1 << 14;
+
+/**
+ * Compute the bounding box of every block of blockSize consecutive boxes, skipping empty ones
+ */
+static void boundBlocks(std::vector<Platform> const &platforms, std::vector<Platform> &blocks, size_t first,
+                        size_t end) {
+    for (size_t block = first; block < end; block++) {
+        glm::vec3 lower(1e30f), upper(-1e30f);
+        size_t last = std::min(platforms.size(), (block + 1) * World::blockSize);
+        for (size_t i = block * World::blockSize; i < last; i++) {
+            Platform const &p = platforms[i];
+            if (p.size.x <= 0) continue;
+            lower = glm::min(lower, p.pos - p.size);
+            upper = glm::max(upper, p.pos + p.size);
+        }
+
+        // A block without platforms gets no size, like an empty slot
+        blocks[block] = lower.x <= upper.x
+                        ? Platform{(lower + upper) * .5f, (upper - lower) * .5f}
+                        : Platform{glm::vec3(0), glm::vec3(0)};
+    }
+}
+
+glm::vec3 MovingPlatform::positionAt(float time) const {
+    float angle = speed * time + phase;
+    return pos + sine * std::sin(angle) + cosine * std::cos(angle);
+}
+
+Platform MovingPlatform::getBounds() const {
+    return Platform{pos, size + glm::abs(sine) + glm::abs(cosine)};
+}
+
+World::World() = default;
+
+World::World(World &&other) = default;
+
+World &World::operator=(World &&other) = default;
+
+World::~World() = default;
+
 glm::mat4 World::getModelMatrix() {
     return glm::mat4(1.f);
 }
 
 void World::initialize() {
-    srand((unsigned) time(nullptr));
-    float x = 0, y = 0, z = 0;
-    float sx = .5, sy = .02, sz = .5;
+    initialize((uint64_t) time(nullptr), 201);
+}
+
+void World::initialize(uint64_t seed, size_t numOfPlatforms) {
+    streamer.reset();
+    liveChunks.clear();
 
-    platforms = std::vector<Platform>{
-            Platform{glm::vec3(x, y, z), glm::vec3(sx, sy, sz)},
-//            Platform{glm::vec3(1, 0.25, 0), glm::vec3(.5, 0.02, .5)},
-//            Platform{glm::vec3(1, 0.5, 1), glm::vec3(.5, 0.02, .5)},
-//            Platform{glm::vec3(0, 0.75, 1), glm::vec3(.5, 0.02, .5)},
-//            Platform{glm::vec3(0, 1.1, 2.5), glm::vec3(.5, 0.02, .5)},
-//            Platform{glm::vec3(0, 1.6, 3.8), glm::vec3(.5, 0.02, .5)},
-    };
+    PlatformChain chain(seed);
+    chain.generate(numOfPlatforms, platforms);
+    motionTime = 0;
 
+    if (platforms.size() < parallelThreshold) {
+        chain.generateMoving(platforms, movingInterval, motionPeriod, movingPlatforms);
+        updateMovingPlatforms();
+        grid.build(platforms);
+        updateBlocks();
+        return;
+    }
 
-    size_t numOfPlatforms = 200;
+    // The grid, the blocks and the moving platforms only read the platforms, so they are built at the same time
+    JobSystem &jobs = JobSystem::global();
+    JobGroup group;
+    jobs.run(group, [this] { grid.build(platforms); });
+    jobs.run(group, [this, &chain] {
+        chain.generateMoving(platforms, movingInterval, motionPeriod, movingPlatforms);
+        updateMovingPlatforms();
+    });
+    updateBlocks();
+    jobs.wait(group);
+}
 
-    for (auto i = 0; i < numOfPlatforms; i++) {
-        auto y_offset = (rand() % 100) / 100. * 0.4 + .1;
+void World::updateBlocks() {
+    blocks.resize((platforms.size() + blockSize - 1) / blockSize);
 
-//        if (y - y_offset < 0) {
-//            y_offset = 0.5;
-//        }
+    if (platforms.size() < parallelThreshold) {
+        boundBlocks(platforms, blocks, 0, blocks.size());
+    } else {
+        JobSystem::global().parallelFor(blocks.size(), 64, [this](size_t first, size_t end) {
+            boundBlocks(platforms, blocks, first, end);
+        });
+    }
+}
 
-        auto new_xs = (rand() % 100) / 100. * .7 + .1;
-        auto new_zs = (rand() % 100) / 100. * .7 + .1;
+void World::updateMovingPlatforms() {
+    movingBounds.resize(movingPlatforms.size());
+    maxRiseSpeed = 0;
+    for (size_t i = 0; i < movingPlatforms.size(); i++) {
+        MovingPlatform const &moving = movingPlatforms[i];
+        movingBounds[i] = moving.getBounds();
 
-        double max_offs_x = .8 + sx + new_xs;
-        double max_offs_z = .8 + sz + new_zs;
+        // a sin + b cos peaks at sqrt(a^2 + b^2)
+        float rise = moving.speed * std::sqrt(moving.sine.y * moving.sine.y + moving.cosine.y * moving.cosine.y);
+        maxRiseSpeed = std::max(maxRiseSpeed, rise);
+    }
 
-        auto x_offset = (rand() % 100) / 100. * 2 * max_offs_x - max_offs_x;
-//        if (x_offset != 0)
-//            x_offset += (sx + new_xs) * (x_offset / abs(x_offset));
-        auto z_offset = (rand() % 100) / 100. * 2 * max_offs_z - max_offs_z;
-//        if (z_offset != 0)
-//            z_offset += (sz + new_zs) * (z_offset / abs(z_offset));
+    movingBlocks.resize((movingBounds.size() + blockSize - 1) / blockSize);
+    boundBlocks(movingBounds, movingBlocks, 0, movingBlocks.size());
+    movingGrid.build(movingBounds);
+}
 
-        x += x_offset;
-        y += y_offset;
-        z += z_offset;
+void World::advance(float delta) {
+    motionTime += delta;
+    if (motionTime >= motionPeriod) motionTime -= motionPeriod;
+}
 
-        sx = new_xs;
-        sz = new_zs;
+bool World::sweepMovingPlatforms(glm::vec3 origin, glm::vec2 halfSize, glm::vec3 movement, float delta,
+                                 PlatformHit &hit) const {
+    // Half of every bounce goes up faster than any platform, no need to look for one then
+    if (movingPlatforms.empty() || !(movement.y < maxRiseSpeed * delta)) return false;
 
-        platforms.push_back(Platform{glm::vec3(x, y, z), glm::vec3(sx, sy, sz)});
+    // Moving platforms whose box overlaps the box around the movement
+    glm::vec3 end = origin + movement;
+    glm::vec3 lower = glm::min(origin, end) - glm::vec3(halfSize.x, 0, halfSize.y);
+    glm::vec3 upper = glm::max(origin, end) + glm::vec3(halfSize.x, 0, halfSize.y);
+    static thread_local std::vector<size_t> nearby;
+    movingGrid.queryAABB(lower, upper, nearby);
+    if (nearby.empty()) return false;
+
+    // The box moves relative to every platform, so each of them gets its own sweep
+    bool found = false;
+    static thread_local PlatformBounds bounds;
+    for (size_t index: nearby) {
+        MovingPlatform const &moving = movingPlatforms[index];
+        glm::vec3 from = moving.positionAt(motionTime);
+        glm::vec3 to = moving.positionAt(motionTime + delta);
+        glm::vec3 relative = movement - (to - from);
+        if (!(relative.y < 0)) continue;
+
+        bounds.reset(1);
+        bounds.add(Platform{from, moving.size}, (uint32_t) index);
+        PlatformHit candidate;
+        bool hitThis = false;
+        sweepDownBoundsScalar(bounds, 0, 1, origin, halfSize, relative, candidate, hitThis);
+        if (hitThis && (!found || candidate.time < hit.time)) {
+            hit = candidate;
+            hit.height = to.y + moving.size.y;
+            found = true;
+        }
     }
+    return found;
+}
+
+void World::initializeEndless() {
+    endlessSeed = (unsigned) time(nullptr);
+    restartStreaming();
+}
+
+bool World::isEndless() const {
+    return streamer != nullptr;
+}
+
+float World::getFallHeight() const {
+    float floor = 0;
+    if (!liveChunks.empty() && liveChunks.front().index > 0) floor = liveChunks.front().bottom;
+    return floor - .2f;
+}
+
+void World::restartStreaming() {
+    streamer.reset(new WorldStreamer(endlessSeed, chunkSize));
+    liveChunks.clear();
+    nextChunk = 0;
+
+    platforms.assign(chunkSize * chunkSlots, Platform{glm::vec3(0), glm::vec3(0)});
+    grid.build(platforms);
+    updateBlocks();
+
+    // The streamed chunks have no moving platforms
+    movingPlatforms.clear();
+    updateMovingPlatforms();
+    motionTime = 0;
+}
+
+bool World::updateStreaming(float lowestY) {
+    if (!streamer) return false;
+    bool changed = false;
+
+    // Falls end at the savepoint, whose chunks stay live. Only going back to the start or flying down needs chunks
+    // that were already dropped, the chain is deterministic so start it over.
+    if (lowestY < getFallHeight()) {
+        restartStreaming();
+        changed = true;
+    }
+
+    while (!liveChunks.empty() && liveChunks.front().top < lowestY - evictDistance) {
+        size_t slot = liveChunks.front().index % chunkSlots;
+        std::fill(platforms.begin() + slot * chunkSize, platforms.begin() + (slot + 1) * chunkSize,
+                  Platform{glm::vec3(0), glm::vec3(0)});
+        changed = true;
+        liveChunks.pop_front();
+    }
+
+    WorldChunk chunk;
+    while (liveChunks.size() < chunkSlots && streamer->poll(chunk)) {
+        size_t slot = chunk.index % chunkSlots;
+        std::copy(chunk.platforms.begin(), chunk.platforms.end(), platforms.begin() + slot * chunkSize);
+        changed = true;
+        liveChunks.push_back(LiveChunk{chunk.index, chunk.bottom, chunk.top});
+        nextChunk = chunk.index + 1;
+    }
+
+    // Keep the worker busy filling every free slot, generation never runs further ahead than that
+    int firstChunk = liveChunks.empty() ? nextChunk : liveChunks.front().index;
+    streamer->requestUpTo(firstChunk + (int) chunkSlots - 1);
+
+    if (!changed) return false;
+
+    grid.build(platforms);
+    updateBlocks();
+    return true;
 }
@@ -1,9 +1,15 @@
 #ifndef OPENGL_TEMPLATE_WORLD_H
 #define OPENGL_TEMPLATE_WORLD_H
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 
+#include "spatial_grid.h"
+
 struct Platform {
     /**
      * Position of the platform
@@ -16,8 +22,122 @@ struct Platform {
     glm::vec3 size;
 };
 
+/**
+ * Platform that moves around its center on a closed path, evaluated in closed form from the time so the
+ * vertex shader and the collision agree without uploading positions:
+ * pos + sine * sin(speed * time + phase) + cosine * cos(speed * time + phase)
+ *
+ * The members are laid out as the per-instance attributes of the world shader.
+ */
+struct MovingPlatform {
+    /**
+     * Center of the motion and size of the platform
+     */
+    glm::vec3 pos;
+    glm::vec3 size;
+
+    /**
+     * Offsets at a quarter and at the start of a cycle, a line for parallel vectors and an ellipse otherwise
+     */
+    glm::vec3 sine;
+    float speed;
+    glm::vec3 cosine;
+    float phase;
+
+    /**
+     * Get the position of the platform at a time
+     *
+     * @param time motion time of the world
+     * @return center of the platform
+     */
+    glm::vec3 positionAt(float time) const;
+
+    /**
+     * Get the box the platform stays in during its whole motion
+     *
+     * @return box as platform with center and half size
+     */
+    Platform getBounds() const;
+};
+
+class WorldStreamer;
+
 class World {
+    /**
+     * Chunk that is currently stored in one of the platform slots of the endless mode
+     */
+    struct LiveChunk {
+        int index;
+        float bottom;
+        float top;
+    };
+
+    /**
+     * Generates the chunks in endless mode, empty for a fixed world
+     */
+    std::unique_ptr<WorldStreamer> streamer;
+
+    /**
+     * Seed of the endless chain, kept to generate it again from the start
+     */
+    unsigned endlessSeed = 0;
+
+    /**
+     * Chunks in the platform slots, ordered from lowest to highest
+     */
+    std::deque<LiveChunk> liveChunks;
+
+    /**
+     * Index of the next chunk that is expected from the streamer
+     */
+    int nextChunk = 0;
+
+    /**
+     * Start generating the endless chain from its first chunk
+     */
+    void restartStreaming();
+
+    /**
+     * Recompute the bounding boxes of the platform blocks
+     */
+    void updateBlocks();
+
+    /**
+     * Recompute the boxes, blocks and grid of the moving platforms
+     */
+    void updateMovingPlatforms();
+
 public:
+    /**
+     * Number of platforms per chunk and number of chunk slots in endless mode
+     */
+    static const size_t chunkSize = 64;
+    static const size_t chunkSlots = 8;
+
+    /**
+     * Every movingInterval-th platform of a fixed world has a moving platform next to it
+     */
+    static const size_t movingInterval = 8;
+
+    /**
+     * Every moving platform completes a whole number of cycles in this time, so the motion time wraps
+     * around without a jump and keeps its float precision
+     */
+    static constexpr float motionPeriod = 30.f;
+
+    /**
+     * Distance below the player after which chunks are dropped
+     */
+    float evictDistance = 10.f;
+
+    /**
+     * Constructors, assignment and destructor, defined where WorldStreamer is complete
+     */
+    World();
+    World(World &&other);
+    World &operator=(World &&other);
+    ~World();
+
     /**
      * Get the model matrix of the game world
      *
@@ -26,14 +146,106 @@ public:
     static glm::mat4 getModelMatrix();
 
     /**
-     * All platforms of the game world
+     * All platforms of the game world. In endless mode these are chunkSlots slots of chunkSize platforms,
+     * empty slots hold platforms of size zero.
      */
     std::vector<Platform> platforms;
 
+    /**
+     * Spatial index over the platforms for collision queries
+     */
+    SpatialGrid grid;
+
+    /**
+     * Bounding box of every block of blockSize consecutive platforms, stored as a platform with center and
+     * half size. In endless mode a block is exactly one chunk slot.
+     */
+    static const size_t blockSize = chunkSize;
+    std::vector<Platform> blocks;
+
+    /**
+     * Moving platforms, the boxes they stay in and the bounding boxes of blocks of blockSize of them
+     */
+    std::vector<MovingPlatform> movingPlatforms;
+    std::vector<Platform> movingBounds;
+    std::vector<Platform> movingBlocks;
+
+    /**
+     * Spatial index over the boxes of the moving platforms, for finding the ones near the player
+     */
+    SpatialGrid movingGrid;
+
+    /**
+     * Highest upward speed of any moving platform, a box that rises faster can't land on one
+     */
+    float maxRiseSpeed = 0;
+
+    /**
+     * Time of the moving platforms in seconds, from 0 to motionPeriod
+     */
+    float motionTime = 0;
+
     /**
      * Initialize the world with new platforms
      */
     void initialize();
+
+    /**
+     * Initialize the world with a chain of platforms, the same seed always gives the same world
+     *
+     * @param seed seed of the platform chain
+     * @param numOfPlatforms number of platforms including the start platform
+     */
+    void initialize(uint64_t seed, size_t numOfPlatforms);
+
+    /**
+     * Initialize an endless world that is generated in chunks while the player climbs
+     */
+    void initializeEndless();
+
+    /**
+     * True if the world is generated endlessly
+     *
+     * @return true in endless mode
+     */
+    bool isEndless() const;
+
+    /**
+     * Height below which the player has fallen off and goes back to its savepoint. In endless mode that is below
+     * the lowest chunk that is still live, there is nothing to land on further down.
+     *
+     * @return height of the bottom of the player
+     */
+    float getFallHeight() const;
+
+    /**
+     * Take finished chunks from the generator and drop chunks far below, never blocks
+     *
+     * @param lowestY lowest height that must stay available, e.g. the player or its savepoint
+     * @return true if any platform changed
+     */
+    bool updateStreaming(float lowestY);
+
+    /**
+     * Advance the moving platforms by one simulation step
+     *
+     * @param delta length of the step
+     */
+    void advance(float delta);
+
+    /**
+     * Sweep a box like SpatialGrid::sweepDown against the moving platforms near it. They are evaluated at the
+     * start and the end of the step, and the box is swept relative to them, so rising platforms catch it too.
+     *
+     * @param origin center of the bottom face of the box at the start of the step
+     * @param halfSize half size of the box in x and z direction
+     * @param movement movement of the box during the step
+     * @param delta length of the step, the platforms start at motionTime
+     * @param hit first hit, its height is the top face at the end of the step
+     * @return true if a moving platform was hit
+     */
+    bool sweepMovingPlatforms(glm::vec3 origin, glm::vec2 halfSize, glm::vec3 movement, float delta,
+                              PlatformHit &hit) const;
 };
 
 
@@ -0,0 +1,63 @@
+#include "world_streamer.h"
+
+#include <algorithm>
+
+WorldStreamer::WorldStreamer(unsigned seed, size_t chunkSize) : chain(seed), chunkSize(chunkSize) {
+    worker = std::thread(&WorldStreamer::run, this);
+}
+
+WorldStreamer::~WorldStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void WorldStreamer::requestUpTo(int index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index <= requested) return;
+        requested = index;
+    }
+    wake.notify_one();
+}
+
+bool WorldStreamer::poll(WorldChunk &chunk) {
+    // The render loop must not wait for the worker, so give up if it holds the lock
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock() || ready.empty()) return false;
+
+    chunk = std::move(ready.front());
+    ready.pop_front();
+    return true;
+}
+
+void WorldStreamer::run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || nextIndex <= requested; });
+            if (stopping) return;
+        }
+
+        // Generate without holding the lock
+        WorldChunk chunk;
+        chunk.index = nextIndex;
+        chunk.platforms.reserve(chunkSize);
+        if (nextIndex == 0) chunk.platforms.push_back(chain.first());
+        while (chunk.platforms.size() < chunkSize) chunk.platforms.push_back(chain.next());
+
+        chunk.bottom = chunk.platforms.front().pos.y - chunk.platforms.front().size.y;
+        chunk.top = chunk.bottom;
+        for (Platform const &p: chunk.platforms) {
+            chunk.bottom = std::min(chunk.bottom, p.pos.y - p.size.y);
+            chunk.top = std::max(chunk.top, p.pos.y + p.size.y);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(std::move(chunk));
+        nextIndex++;
+    }
+}
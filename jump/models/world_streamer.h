@@ -0,0 +1,107 @@
+#ifndef OPENGL_TEMPLATE_WORLD_STREAMER_H
+#define OPENGL_TEMPLATE_WORLD_STREAMER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "platform_chain.h"
+
+/**
+ * A fixed number of consecutive platforms of the endless chain
+ */
+struct WorldChunk {
+    /**
+     * Number of the chunk, counted from the start of the chain
+     */
+    int index;
+
+    /**
+     * Lowest bottom and highest top of all platforms in the chunk
+     */
+    float bottom;
+    float top;
+
+    /**
+     * Platforms of the chunk
+     */
+    std::vector<Platform> platforms;
+};
+
+/**
+ * Generates chunks of the endless platform chain on a worker thread
+ */
+class WorldStreamer {
+    /**
+     * Chain the chunks are cut from, only used by the worker
+     */
+    PlatformChain chain;
+
+    /**
+     * Number of platforms per chunk
+     */
+    size_t chunkSize;
+
+    /**
+     * Index of the next chunk the worker generates
+     */
+    int nextIndex = 0;
+
+    /**
+     * Highest chunk index that was requested
+     */
+    int requested = -1;
+
+    /**
+     * True if the worker should exit
+     */
+    bool stopping = false;
+
+    /**
+     * Finished chunks waiting to be picked up, in order
+     */
+    std::deque<WorldChunk> ready;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+
+    /**
+     * Worker loop
+     */
+    void run();
+
+public:
+    /**
+     * Constructor, starts the worker
+     *
+     * @param seed seed of the platform chain
+     * @param chunkSize number of platforms per chunk
+     */
+    WorldStreamer(unsigned seed, size_t chunkSize);
+
+    /**
+     * Destructor, stops the worker
+     */
+    ~WorldStreamer();
+
+    /**
+     * Let the worker generate all chunks up to an index
+     *
+     * @param index highest chunk index to generate
+     */
+    void requestUpTo(int index);
+
+    /**
+     * Take the next finished chunk, never blocks
+     *
+     * @param chunk receives the chunk
+     * @return true if a chunk was available
+     */
+    bool poll(WorldChunk &chunk);
+};
+
+
+#endif //OPENGL_TEMPLATE_WORLD_STREAMER_H
@@ -0,0 +1,25 @@
+// Converts an OBJ file into the binary mesh format of common/meshbinary.hpp
+//
+// Usage : obj2mesh input.obj output.mesh
+
+#include <stdio.h>
+
+#include "common/objparser.hpp"
+#include "common/meshbinary.hpp"
+
+int main(int argc, char ** argv){
+	if (argc != 3){
+		fprintf(stderr, "Usage : %s input.obj output.mesh\n", argv[0]);
+		return 1;
+	}
+
+	IndexedMesh mesh;
+	if (!loadOBJIndexed(argv[1], mesh))
+		return 1;
+
+	if (!saveMeshBinary(argv[2], mesh.vertices, mesh.uvs, mesh.normals, mesh.indices))
+		return 1;
+
+	printf("%s : %zu vertices, %zu triangles\n", argv[2], mesh.vertices.size(), mesh.indices.size() / 3);
+	return 0;
+}